@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2022-2023, smartmx - smartmx@qq.com
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2026-10-19     smartmx      the first version, posix file and linux mtd port.
+ * 2026-10-19     smartmx      add tfdb_dev_t support.
+ * 2026-10-19     smartmx      close the opened file when opening again, fill erased value by bytes.
+ * 2026-10-19     smartmx      fill erased value with value_after_erase_size, don't sync the file not opened.
+ *
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef __linux__
+    #include <mtd/mtd-user.h>
+#endif
+#include "tfdb_port_posix.h"
+
+/* the erase emulation of regular file writes this size every time. */
+#define TFDB_POSIX_ERASE_CHUNK              256
+
+#if (TFDB_USE_DEVICE == 0)
+static tfdb_posix_t tfdb_posix_default = { .fd = -1 };
+#endif
+
+/**
+ * check the operation range and convert tfdb address to file offset.
+ *
+ * @param posix the opened file.
+ * @param addr flash address.
+ * @param size operation bytes size.
+ * @param offset the pointer to save file offset.
+ *
+ * @return uint8_t 1 means the range is legal.
+ */
+static uint8_t tfdb_posix_offset(const tfdb_posix_t *posix, tfdb_addr_t addr, size_t size, off_t *offset)
+{
+    if ((posix->opened == 0) || (addr < posix->base))
+    {
+        return 0;
+    }
+    if (((size_t)(addr - posix->base) > posix->size) || (size > (posix->size - (addr - posix->base))))
+    {
+        return 0;
+    }
+    *offset = (off_t)(addr - posix->base);
+    return 1;
+}
+
+/**
+ * write all data which is cached by system to the file.
+ *
+ * @param posix the opened file.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_posix_sync(tfdb_posix_t *posix)
+{
+    posix->sync_count = 0;
+    if ((posix->opened == 0) || posix->is_mtd)
+    {
+        return TFDB_NO_ERR;
+    }
+    if (fdatasync(posix->fd) != 0)
+    {
+        return TFDB_WRITE_ERR;
+    }
+    return TFDB_NO_ERR;
+}
+
+/**
+ * fsync the file according to sync_mode after modifying.
+ *
+ * @param posix the opened file.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_posix_after_modify(tfdb_posix_t *posix)
+{
+    if (posix->is_mtd)
+    {
+        /* mtd write and erase are finished when the call returns. */
+        return TFDB_NO_ERR;
+    }
+    if (posix->sync_mode == TFDB_POSIX_SYNC_EACH)
+    {
+        return tfdb_posix_sync(posix);
+    }
+    if (posix->sync_mode == TFDB_POSIX_SYNC_BATCH)
+    {
+        posix->sync_count++;
+        if (posix->sync_count >= posix->sync_batch)
+        {
+            return tfdb_posix_sync(posix);
+        }
+    }
+    return TFDB_NO_ERR;
+}
+
+/**
+ * fill the file with erased value.
+ * the value_after_erase_size bytes of erased value are in the same order as the value in memory,
+ * the same as tinyflashdb compares them, and they are aligned with the address.
+ *
+ * @param posix the opened file.
+ * @param offset the file offset.
+ * @param size fill bytes size.
+ *
+ * @return uint8_t 1 means success.
+ */
+static uint8_t tfdb_posix_fill_erased(tfdb_posix_t *posix, off_t offset, size_t size)
+{
+    uint8_t fill[TFDB_POSIX_ERASE_CHUNK];
+    uint8_t pattern[4];
+    uint16_t value16;
+    uint32_t value32;
+    size_t i;
+    ssize_t len;
+
+    if (posix->value_after_erase_size == 4)
+    {
+        value32 = posix->value_after_erase;
+        memcpy(pattern, &value32, 4);
+    }
+    else if (posix->value_after_erase_size == 2)
+    {
+        value16 = (uint16_t)posix->value_after_erase;
+        memcpy(pattern, &value16, 2);
+    }
+    else
+    {
+        pattern[0] = (uint8_t)posix->value_after_erase;
+    }
+    /* TFDB_POSIX_ERASE_CHUNK is multiple of 4, so every chunk starts with the same byte of pattern. */
+    for (i = 0; i < sizeof(fill); i++)
+    {
+        fill[i] = pattern[((size_t)(posix->base + offset) + i) % posix->value_after_erase_size];
+    }
+    for (i = 0; i < size; i += len)
+    {
+        len = (size - i) > sizeof(fill) ? sizeof(fill) : (size - i);
+        len = pwrite(posix->fd, fill, len, offset + i);
+        if (len <= 0)
+        {
+            if ((len < 0) && (errno == EINTR))
+            {
+                len = 0;
+                continue;
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * sync and close the file.
+ *
+ * @param posix the opened file.
+ */
+static void tfdb_posix_close(tfdb_posix_t *posix)
+{
+    if (posix->opened == 0)
+    {
+        return;
+    }
+    tfdb_posix_sync(posix);
+    if (posix->map != NULL)
+    {
+        munmap((void *)posix->map, posix->size);
+        posix->map = NULL;
+    }
+    close(posix->fd);
+    posix->fd = -1;
+    posix->opened = 0;
+}
+
+/**
+ * open the file or mtd device which is used as flash, the file opened before is closed first.
+ * regular file which is shorter than config->size will be extended with erased value.
+ *
+ * @param posix the file to open.
+ * @param config the posix port config.
+ * @param value_after_erase the data value in flash after erased.
+ * @param value_after_erase_size the size of value_after_erase.
+ * @param write_unit the flash write granularity.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_posix_open(tfdb_posix_t *posix, const tfdb_posix_config_t *config, uint32_t value_after_erase, uint8_t value_after_erase_size, uint8_t write_unit)
+{
+    struct stat st;
+#ifdef __linux__
+    struct mtd_info_user mtd_info;
+#endif
+
+    tfdb_posix_close(posix);
+    posix->fd = open(config->path, O_RDWR | O_CREAT, 0644);
+    if (posix->fd < 0)
+    {
+        TFDB_DEBUG("    open %s err:%d\n", config->path, errno);
+        return TFDB_FLASH_ERR;
+    }
+    if (fstat(posix->fd, &st) != 0)
+    {
+        goto err;
+    }
+
+    posix->opened = 1;
+    posix->base = config->base;
+    posix->map = NULL;
+    posix->value_after_erase = value_after_erase;
+    posix->value_after_erase_size = ((value_after_erase_size == 2) || (value_after_erase_size == 4)) ? value_after_erase_size : 1;
+    posix->sync_mode = config->sync_mode;
+    posix->sync_batch = (config->sync_batch == 0) ? 1 : config->sync_batch;
+    posix->sync_count = 0;
+
+    if (S_ISCHR(st.st_mode))
+    {
+#ifdef __linux__
+        if (ioctl(posix->fd, MEMGETINFO, &mtd_info) != 0)
+        {
+            TFDB_DEBUG("    %s is not mtd device\n", config->path);
+            goto err;
+        }
+        if (mtd_info.writesize > write_unit)
+        {
+            TFDB_DEBUG("    mtd writesize %u is bigger than write unit\n", mtd_info.writesize);
+            goto err;
+        }
+        posix->is_mtd = 1;
+        posix->size = mtd_info.size;
+        if ((config->size != 0) && (config->size < posix->size))
+        {
+            posix->size = config->size;
+        }
+#else
+        goto err;
+#endif
+    }
+    else
+    {
+        posix->is_mtd = 0;
+        posix->size = (config->size != 0) ? config->size : (size_t)st.st_size;
+        if ((size_t)st.st_size < posix->size)
+        {
+            /* extend the file as erased flash. */
+            if ((!tfdb_posix_fill_erased(posix, st.st_size, posix->size - (size_t)st.st_size)) || (fsync(posix->fd) != 0))
+            {
+                goto err;
+            }
+        }
+    }
+
+    if (config->use_mmap && (posix->size != 0))
+    {
+        posix->map = mmap(NULL, posix->size, PROT_READ, MAP_SHARED, posix->fd, 0);
+        if (posix->map == MAP_FAILED)
+        {
+            /* most mtd devices don't support mmap, use pread. */
+            TFDB_DEBUG("    mmap err:%d, use pread\n", errno);
+            posix->map = NULL;
+        }
+    }
+
+    return TFDB_NO_ERR;
+err:
+    close(posix->fd);
+    posix->fd = -1;
+    posix->opened = 0;
+    return TFDB_FLASH_ERR;
+}
+
+/**
+ * Read data from file.
+ *
+ * @param posix the opened file.
+ * @param addr flash address.
+ * @param buf buffer to store read data.
+ * @param size read bytes size.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_posix_read(tfdb_posix_t *posix, tfdb_addr_t addr, uint8_t *buf, size_t size)
+{
+    off_t offset;
+    ssize_t len;
+
+    if (!tfdb_posix_offset(posix, addr, size, &offset))
+    {
+        return TFDB_READ_ERR;
+    }
+    if (posix->map != NULL)
+    {
+        tfdb_memcpy(buf, posix->map + offset, size);
+        return TFDB_NO_ERR;
+    }
+    while (size > 0)
+    {
+        len = pread(posix->fd, buf, size, offset);
+        if (len <= 0)
+        {
+            if ((len < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            return TFDB_READ_ERR;
+        }
+        buf += len;
+        offset += len;
+        size -= len;
+    }
+    return TFDB_NO_ERR;
+}
+
+/**
+ * Erase file.
+ * mtd device uses MEMERASE, the range must be aligned with erase block of mtd.
+ * regular file is filled with erased value.
+ *
+ * @param posix the opened file.
+ * @param addr flash address.
+ * @param size erase bytes size.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_posix_erase(tfdb_posix_t *posix, tfdb_addr_t addr, size_t size)
+{
+    off_t offset;
+#ifdef __linux__
+    struct erase_info_user erase_info;
+#endif
+
+    if (!tfdb_posix_offset(posix, addr, size, &offset))
+    {
+        return TFDB_ERASE_ERR;
+    }
+    if (posix->is_mtd)
+    {
+#ifdef __linux__
+        erase_info.start = (uint32_t)offset;
+        erase_info.length = (uint32_t)size;
+        if (ioctl(posix->fd, MEMERASE, &erase_info) != 0)
+        {
+            TFDB_DEBUG("    MEMERASE err:%d\n", errno);
+            return TFDB_ERASE_ERR;
+        }
+#endif
+        return TFDB_NO_ERR;
+    }
+    if ((!tfdb_posix_fill_erased(posix, offset, size)) || (tfdb_posix_after_modify(posix) != TFDB_NO_ERR))
+    {
+        return TFDB_ERASE_ERR;
+    }
+    return TFDB_NO_ERR;
+}
+
+/**
+ * Write data to file.
+ * regular file is overwritten directly, TFDB will check data after writing.
+ *
+ * @param posix the opened file.
+ * @param addr flash address.
+ * @param buf the write data buffer.
+ * @param size write bytes size.
+ *
+ * @return result
+ */
+static TFDB_Err_Code tfdb_posix_write(tfdb_posix_t *posix, tfdb_addr_t addr, const uint8_t *buf, size_t size)
+{
+    off_t offset;
+    ssize_t len;
+
+    if (!tfdb_posix_offset(posix, addr, size, &offset))
+    {
+        return TFDB_WRITE_ERR;
+    }
+    while (size > 0)
+    {
+        len = pwrite(posix->fd, buf, size, offset);
+        if (len <= 0)
+        {
+            if ((len < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            return TFDB_WRITE_ERR;
+        }
+        buf += len;
+        offset += len;
+        size -= len;
+    }
+    return tfdb_posix_after_modify(posix);
+}
+
+#if TFDB_USE_DEVICE
+
+/**
+ * open the file or mtd device of dev, dev->user_data must point to a tfdb_posix_t.
+ *
+ * @param dev the flash device.
+ * @param config the posix port config.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_posix_dev_open(const tfdb_dev_t *dev, const tfdb_posix_config_t *config)
+{
+    return tfdb_posix_open((tfdb_posix_t *)dev->user_data, config, dev->value_after_erase, dev->value_after_erase_size, dev->write_unit);
+}
+
+/**
+ * write all data which is cached by system to the file of dev.
+ *
+ * @param dev the flash device.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_posix_dev_sync(const tfdb_dev_t *dev)
+{
+    return tfdb_posix_sync((tfdb_posix_t *)dev->user_data);
+}
+
+/**
+ * sync and close the file of dev.
+ *
+ * @param dev the flash device.
+ */
+void tfdb_posix_dev_close(const tfdb_dev_t *dev)
+{
+    tfdb_posix_close((tfdb_posix_t *)dev->user_data);
+}
+
+/**
+ * Read data from the file of dev.
+ */
+TFDB_Err_Code tfdb_posix_dev_read(const tfdb_dev_t *dev, tfdb_addr_t addr, uint8_t *buf, size_t size)
+{
+    return tfdb_posix_read((tfdb_posix_t *)dev->user_data, addr, buf, size);
+}
+
+/**
+ * Erase the file of dev.
+ */
+TFDB_Err_Code tfdb_posix_dev_erase(const tfdb_dev_t *dev, tfdb_addr_t addr, size_t size)
+{
+    return tfdb_posix_erase((tfdb_posix_t *)dev->user_data, addr, size);
+}
+
+/**
+ * Write data to the file of dev.
+ */
+TFDB_Err_Code tfdb_posix_dev_write(const tfdb_dev_t *dev, tfdb_addr_t addr, const uint8_t *buf, size_t size)
+{
+    return tfdb_posix_write((tfdb_posix_t *)dev->user_data, addr, buf, size);
+}
+
+#else
+
+/**
+ * open the file or mtd device which is used as flash.
+ * regular file which is shorter than config->size will be extended with TFDB_VALUE_AFTER_ERASE.
+ *
+ * @param config the posix port config.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_port_posix_open(const tfdb_posix_config_t *config)
+{
+    return tfdb_posix_open(&tfdb_posix_default, config, TFDB_VALUE_AFTER_ERASE, TFDB_VALUE_AFTER_ERASE_SIZE, TFDB_WRITE_UNIT_BYTES);
+}
+
+/**
+ * write all data which is cached by system to the file.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_port_posix_sync(void)
+{
+    return tfdb_posix_sync(&tfdb_posix_default);
+}
+
+/**
+ * sync and close the file.
+ */
+void tfdb_port_posix_close(void)
+{
+    tfdb_posix_close(&tfdb_posix_default);
+}
+
+/**
+ * Read data from flash.
+ * @note This operation's units is refer to TFDB_WRITE_UNIT_BYTES.
+ *
+ * @param addr flash address.
+ * @param buf buffer to store read data.
+ * @param size read bytes size.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_port_read(tfdb_addr_t addr, uint8_t *buf, size_t size)
+{
+    return tfdb_posix_read(&tfdb_posix_default, addr, buf, size);
+}
+
+/**
+ * Erase flash.
+ * @param addr flash address.
+ * @param size erase bytes size.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_port_erase(tfdb_addr_t addr, size_t size)
+{
+    return tfdb_posix_erase(&tfdb_posix_default, addr, size);
+}
+
+/**
+ * Write data to flash.
+ * @note This operation's units is refer to TFDB_WRITE_UNIT_BYTES.
+ *
+ * @param addr flash address.
+ * @param buf the write data buffer.
+ * @param size write bytes size.
+ *
+ * @return result
+ */
+TFDB_Err_Code tfdb_port_write(tfdb_addr_t addr, const uint8_t *buf, size_t size)
+{
+    return tfdb_posix_write(&tfdb_posix_default, addr, buf, size);
+}
+
+#endif /* TFDB_USE_DEVICE */
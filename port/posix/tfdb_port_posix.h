@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022-2023, smartmx - smartmx@qq.com
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2026-10-19     smartmx      the first version, posix file and linux mtd port.
+ * 2026-10-19     smartmx      add tfdb_dev_t support.
+ * 2026-10-19     smartmx      add opened flag.
+ *
+ */
+#ifndef _TFDB_PORT_POSIX_H_
+#define _TFDB_PORT_POSIX_H_
+
+#include "tinyflashdb.h"
+
+/* fsync the file only when sync function is called. */
+#define TFDB_POSIX_SYNC_NONE                0
+/* fsync the file after every write and erase. */
+#define TFDB_POSIX_SYNC_EACH                1
+/* fsync the file after every sync_batch writes and erases. */
+#define TFDB_POSIX_SYNC_BATCH               2
+
+typedef struct _tfdb_posix_config_struct
+{
+    const char     *path;           /* regular file or mtd character device, like /dev/mtd3 */
+    tfdb_addr_t     base;           /* the tfdb address which is mapped to offset 0 of path */
+    size_t          size;           /* regular file will be created and extended to this size, 0 means use mtd or file size */
+    uint8_t         sync_mode;      /* TFDB_POSIX_SYNC_NONE / TFDB_POSIX_SYNC_EACH / TFDB_POSIX_SYNC_BATCH */
+    uint16_t        sync_batch;     /* used with TFDB_POSIX_SYNC_BATCH */
+    uint8_t         use_mmap;       /* read through mmap, fall back to pread when the device can't be mapped */
+} tfdb_posix_config_t;
+
+/* the opened file, all members are private, it can be zero initialized. */
+typedef struct _tfdb_posix_struct
+{
+    uint8_t         opened;         /* 1 when fd is opened */
+    int             fd;
+    tfdb_addr_t     base;
+    size_t          size;
+    const uint8_t  *map;
+    uint32_t        value_after_erase;
+    uint8_t         value_after_erase_size;
+    uint8_t         is_mtd;
+    uint8_t         sync_mode;
+    uint16_t        sync_batch;
+    uint16_t        sync_count;
+} tfdb_posix_t;
+
+#if TFDB_USE_DEVICE
+
+/* dev->user_data must point to a tfdb_posix_t, for example:
+ * const tfdb_dev_t my_dev = { tfdb_posix_dev_read, tfdb_posix_dev_erase, tfdb_posix_dev_write, &my_posix, 0xff, 1, 1, TFDB_DEV_CAP_NONE }; */
+extern TFDB_Err_Code tfdb_posix_dev_open(const tfdb_dev_t *dev, const tfdb_posix_config_t *config);
+
+extern TFDB_Err_Code tfdb_posix_dev_sync(const tfdb_dev_t *dev);
+
+extern void tfdb_posix_dev_close(const tfdb_dev_t *dev);
+
+extern TFDB_Err_Code tfdb_posix_dev_read(const tfdb_dev_t *dev, tfdb_addr_t addr, uint8_t *buf, size_t size);
+
+extern TFDB_Err_Code tfdb_posix_dev_erase(const tfdb_dev_t *dev, tfdb_addr_t addr, size_t size);
+
+extern TFDB_Err_Code tfdb_posix_dev_write(const tfdb_dev_t *dev, tfdb_addr_t addr, const uint8_t *buf, size_t size);
+
+#else
+
+extern TFDB_Err_Code tfdb_port_posix_open(const tfdb_posix_config_t *config);
+
+extern TFDB_Err_Code tfdb_port_posix_sync(void);
+
+extern void tfdb_port_posix_close(void);
+
+#endif /* TFDB_USE_DEVICE */
+
+#endif
@@ -11,9 +11,12 @@
  * 2022-03-15     smartmx      fix bugs, add support for stm32l4 flash
  * 2022-08-02     smartmx      add TFDB_VALUE_AFTER_ERASE_SIZE option
  * 2023-02-22     smartmx      add dual flash index function
+ * 2026-10-19     smartmx      add operation record functions
+ * 2026-10-19     smartmx      add blank check function
+ * 2026-10-19     smartmx      share tick function with write budget
  *
  */
-#include "tfdb_port.h"
+#include "tinyflashdb.h"
 
 /**
  * Read data from flash.
@@ -70,4 +73,59 @@ TFDB_Err_Code tfdb_port_write(tfdb_addr_t addr, const uint8_t *buf, size_t size)
     return result;
 }
 
+#if (TFDB_USE_BLANK_CHECK == 2)
 
+/**
+ * Check if flash is erased, such as using the blank check command of flash.
+ *
+ * @param addr flash address.
+ * @param size check bytes size.
+ * @param blank set to 1 when all bytes are TFDB_VALUE_AFTER_ERASE, otherwise 0.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_port_blank_check(tfdb_addr_t addr, size_t size, uint8_t *blank)
+{
+    TFDB_Err_Code result = TFDB_NO_ERR;
+    /* You can add your code under here. */
+
+    return result;
+}
+
+#endif /* TFDB_USE_BLANK_CHECK */
+
+#if TFDB_USE_OP_RECORD || TFDB_USE_WRITE_BUDGET
+
+/**
+ * Get the tick for operation records and write budget.
+ * @note the unit of tick is decided by yourself, it is set when replaying and in period of budget.
+ *
+ * @return uint32_t
+ */
+uint32_t tfdb_port_get_tick(void)
+{
+    uint32_t tick = 0;
+    /* You can add your code under here. */
+
+    return tick;
+}
+
+#endif
+
+#if TFDB_USE_OP_RECORD
+
+/**
+ * Save an operation record.
+ * @note the record is TFDB_OP_RECORD_SIZE bytes and little endian, just append it to
+ * RAM buffer, file or uart, the records can be replayed by tools/tfdb_replay.
+ *
+ * @param record the record data.
+ * @param size the size of record.
+ */
+void tfdb_port_record(const uint8_t *record, uint8_t size)
+{
+    /* You can add your code under here. */
+
+}
+
+#endif /* TFDB_USE_OP_RECORD */
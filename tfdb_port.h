@@ -11,6 +11,20 @@
  * 2022-03-15     smartmx      fix bugs, add support for stm32l4 flash
  * 2022-08-02     smartmx      add TFDB_VALUE_AFTER_ERASE_SIZE option
  * 2023-02-22     smartmx      add dual flash index function
+ * 2026-10-19     smartmx      add TFDB_USE_DEVICE option.
+ * 2026-10-19     smartmx      add TFDB_USE_ECC option.
+ * 2026-10-19     smartmx      replace TFDB_LOG with trace ring buffer.
+ * 2026-10-19     smartmx      add TFDB_USE_MIRROR option.
+ * 2026-10-19     smartmx      layout options can be defined by compiler for host tools.
+ * 2026-10-19     smartmx      add TFDB_USE_OP_RECORD option.
+ * 2026-10-19     smartmx      add TFDB_USE_SLOT_MARKER option.
+ * 2026-10-19     smartmx      add TFDB_USE_BLANK_CHECK option.
+ * 2026-10-19     smartmx      add TFDB_USE_BLOB option.
+ * 2026-10-19     smartmx      add TFDB_USE_WRITE_BUDGET option.
+ * 2026-10-19     smartmx      add TFDB_USE_BAD_SLOT option.
+ * 2026-10-19     smartmx      add TFDB_USE_COMPRESS option.
+ * 2026-10-19     smartmx      TFDB_USE_BLANK_CHECK and TFDB_USE_BAD_SLOT can be set by compiler.
+ * 2026-10-19     smartmx      every TFDB_USE_XXX option and TFDB_TRACE_LEVEL can be set by compiler.
  *
  */
 #ifndef _TFDB_PORT_H_
@@ -34,6 +48,8 @@ typedef enum
     TFDB_FLASH2_ERR,
     TFDB_NO_DATA,
     TFDB_NO_PRE_DATA,
+    TFDB_PARAM_ERR,
+    TFDB_BUDGET_ERR,
     TFDB_ERR_MAX,
 } TFDB_Err_Code;
 
@@ -51,9 +67,17 @@ typedef enum
     #define TFDB_MEMCMP_SAME
 #endif
 
+/* only used by port files, tinyflashdb.c uses trace events. */
 #define TFDB_DEBUG                          printf
 
-#define TFDB_LOG                            printf
+/* the trace events over this level are removed when compiling.
+ * 0: off, 1: error, 2: info of api results, 3: debug. */
+#ifndef TFDB_TRACE_LEVEL
+    #define TFDB_TRACE_LEVEL                0
+#endif
+
+/* the count of events in trace ring buffer, must be power of 2. */
+#define TFDB_TRACE_BUFFER_SIZE              32
 
 /* The data value in flash after erased, most are 0xff, some flash maybe different.
  * if it's over 1 byte, please be care of little endian or big endian. */
@@ -64,13 +88,85 @@ typedef enum
 #define TFDB_VALUE_AFTER_ERASE_SIZE         1
 
 /* the flash write granularity, unit: byte
- * only support 1(stm32f4)/ 2(CH559)/ 4(stm32f1)/ 8(stm32L4) */
-#define TFDB_WRITE_UNIT_BYTES               4 /* @note you must define it for a value */
+ * only support 1(stm32f4)/ 2(CH559)/ 4(stm32f1)/ 8(stm32L4)
+ * when TFDB_USE_DEVICE is enabled, it must be the biggest write_unit of all devices. */
+#ifndef TFDB_WRITE_UNIT_BYTES
+    #define TFDB_WRITE_UNIT_BYTES           4 /* @note you must define it for a value */
+#endif
+
+/* use tfdb_dev_t in every index to support multiple flash devices.
+ * the write unit and erased value of each device are set in tfdb_dev_t, tfdb_port_xxx functions are not used. */
+#ifndef TFDB_USE_DEVICE
+    #define TFDB_USE_DEVICE                 0
+#endif
 
 #if TFDB_VALUE_AFTER_ERASE_SIZE > TFDB_WRITE_UNIT_BYTES
     #error "TFDB_VALUE_AFTER_ERASE_SIZE must not bigger than TFDB_WRITE_UNIT_BYTES."
 #endif
 
+/* add hamming SECDED code to every record, one bit error of value is corrected when reading.
+ * the record layout is changed and tagged in header, flash blocks written without ecc get TFDB_HDR_ERR and are erased by tfdb_set. */
+#ifndef TFDB_USE_ECC
+    #define TFDB_USE_ECC                    0
+#endif
+
+/* write progress markers after header, tfdb_get finds the newest record by binary searching the markers,
+ * then only reads the slots of one marker group instead of all empty slots.
+ * the record layout is changed and tagged in header, flash blocks written without markers get TFDB_HDR_ERR and are erased by tfdb_set. */
+#ifndef TFDB_USE_SLOT_MARKER
+    #define TFDB_USE_SLOT_MARKER            0
+#endif
+
+/* the number of markers, every marker takes one write unit, the slots are divided to (TFDB_SLOT_MARKER_NUM + 1) groups. */
+#ifndef TFDB_SLOT_MARKER_NUM
+    #define TFDB_SLOT_MARKER_NUM            15
+#endif
+
+/* keep a RAM copy of value for the index which has a mirror, tfdb_get will not read flash when mirror is valid. */
+#ifndef TFDB_USE_MIRROR
+    #define TFDB_USE_MIRROR                 0
+#endif
+
+/* read flash to verify the mirror every this times of tfdb_get, set 0 will never verify. */
+#ifndef TFDB_MIRROR_VERIFY_PERIOD
+    #define TFDB_MIRROR_VERIFY_PERIOD       0
+#endif
+
+/* record every flash operation and api call by tfdb_port_record, the records can be replayed by tools/tfdb_replay. */
+#ifndef TFDB_USE_OP_RECORD
+    #define TFDB_USE_OP_RECORD              0
+#endif
+
+/* check if flash is erased before erasing flash block in tfdb_init and before writing every record in tfdb_set.
+ * 0: disable, 1: read flash and compare with TFDB_VALUE_AFTER_ERASE in memory order of TFDB_VALUE_AFTER_ERASE_SIZE bytes, 2: use tfdb_port_blank_check, such as hardware blank check command.
+ * with TFDB_USE_DEVICE, blank_check of device is used when TFDB_DEV_CAP_BLANK_CHECK is set, otherwise flash is read and compared.
+ * reading is done in record size with rw_buffer, so mode 1 reads the whole block in (flash_size / record size) reads in tfdb_init,
+ * it's slower than erasing on some flash, use mode 2 if the flash supports blank check command.
+ * tfdb_set erases the flash block at most once when skipping dirty slots, TFDB_FLASH_ERR is returned when it's full again. */
+#ifndef TFDB_USE_BLANK_CHECK
+    #define TFDB_USE_BLANK_CHECK            0
+#endif
+
+/* the streaming api for values larger than RAM, the blob is written and read by chunks with a small buffer. */
+#ifndef TFDB_USE_BLOB
+    #define TFDB_USE_BLOB                   0
+#endif
+
+/* limit the write rate of the index which has a budget, the tokens are refilled by tfdb_port_get_tick. */
+#ifndef TFDB_USE_WRITE_BUDGET
+    #define TFDB_USE_WRITE_BUDGET           0
+#endif
+
+/* remember the slots which failed write verify in RAM map of index, tfdb_set skips them directly until the flash block is erased. */
+#ifndef TFDB_USE_BAD_SLOT
+    #define TFDB_USE_BAD_SLOT               0
+#endif
+
+/* save value with RLE compression for the index which compress is 1, the records are variable length. */
+#ifndef TFDB_USE_COMPRESS
+    #define TFDB_USE_COMPRESS               0
+#endif
+
 /* @note the max retry times when flash is error ,set 0 will disable retry count */
 #define TFDB_WRITE_MAX_RETRY                32
 
@@ -83,5 +179,9 @@ extern TFDB_Err_Code tfdb_port_erase(tfdb_addr_t addr, size_t size);
 
 extern TFDB_Err_Code tfdb_port_write(tfdb_addr_t addr, const uint8_t *buf, size_t size);
 
+#if (TFDB_USE_BLANK_CHECK == 2)
+extern TFDB_Err_Code tfdb_port_blank_check(tfdb_addr_t addr, size_t size, uint8_t *blank);
+#endif
+
 #endif
 
@@ -12,764 +12,3244 @@
  * 2022-08-02     smartmx      add TFDB_VALUE_AFTER_ERASE_SIZE option
  * 2023-02-22     smartmx      add dual flash index function
  * 2023-11-07     smartmx      fix bugs, tfdb_get error when flash write in tfdb_set not success.
+ * 2026-10-19     smartmx      add single buffer dual api.
+ * 2026-10-19     smartmx      add mount table.
+ * 2026-10-19     smartmx      add flash device for each index.
+ * 2026-10-19     smartmx      add TFDB_USE_ECC option.
+ * 2026-10-19     smartmx      replace TFDB_LOG with binary trace events.
+ * 2026-10-19     smartmx      add RAM mirror of value.
+ * 2026-10-19     smartmx      add TFDB_USE_OP_RECORD option.
+ * 2026-10-19     smartmx      add TFDB_USE_SLOT_MARKER option.
+ * 2026-10-19     smartmx      add TFDB_USE_BLANK_CHECK option.
+ * 2026-10-19     smartmx      add streaming blob api.
+ * 2026-10-19     smartmx      add write budget of index.
+ * 2026-10-19     smartmx      add bad slot map of index.
+ * 2026-10-19     smartmx      add RLE compressed record of index.
+ * 2026-10-19     smartmx      skipping dirty slot is not a write retry.
+ * 2026-10-19     smartmx      buffer of blob must be multiple of two write units.
+ * 2026-10-19     smartmx      reject write budget with period or capacity of 0.
+ * 2026-10-19     smartmx      only mark erased slots in tfdb_bad_rebuild, skipping bad slot is not a write retry.
+ * 2026-10-19     smartmx      reject compressed dual index, don't update mirror of compressed index.
+ * 2026-10-19     smartmx      check mirror of dual index before judging seq.
+ * 2026-10-19     smartmx      erase the flash block at most once when skipping slots in a set, compare with the whole erased value.
+ * 2026-10-19     smartmx      reject write budget of dual index.
+ * 2026-10-19     smartmx      clear bad slot map when erasing flash block.
  *
  */
 #include "tinyflashdb.h"
 
+#if TFDB_USE_DEVICE
+    #define TFDB_WRITE_UNIT(index)                  ((index)->dev->write_unit)
+    #define TFDB_ERASED_BYTE(index)                 ((uint8_t)((index)->dev->value_after_erase))
+    #define TFDB_DEV(index)                         ((index)->dev)
+    #define tfdb_flash_read(dev, addr, buf, size)   ((dev)->read((dev), (addr), (buf), (size)))
+    #define tfdb_flash_erase(dev, addr, size)       ((dev)->erase((dev), (addr), (size)))
+    #define tfdb_flash_write(dev, addr, buf, size)  ((dev)->write((dev), (addr), (buf), (size)))
+#else
+    #define TFDB_WRITE_UNIT(index)                  TFDB_WRITE_UNIT_BYTES
+    #define TFDB_ERASED_BYTE(index)                 ((uint8_t)(TFDB_VALUE_AFTER_ERASE))
+    #define TFDB_DEV(index)                         NULL
+    #define tfdb_flash_read(dev, addr, buf, size)   tfdb_port_read((addr), (buf), (size))
+    #define tfdb_flash_erase(dev, addr, size)       tfdb_port_erase((addr), (size))
+    #define tfdb_flash_write(dev, addr, buf, size)  tfdb_port_write((addr), (buf), (size))
+#endif
+
+/* index can be tfdb_index_t or tfdb_blob_index_t. */
+#if TFDB_USE_OP_RECORD
+    #define tfdb_read(index, addr, buf, size)       tfdb_op_read(TFDB_DEV(index), (addr), (buf), (size))
+    #define tfdb_erase(index, addr, size)           tfdb_op_erase(TFDB_DEV(index), (addr), (size))
+    #define tfdb_write(index, addr, buf, size)      tfdb_op_write(TFDB_DEV(index), (addr), (buf), (size))
+    #define TFDB_RECORD_BEGIN(API, ADDR)            tfdb_op_record(TFDB_OP_BEGIN, (ADDR), (API), 0)
+    #define TFDB_RECORD_END(API, ADDR, RESULT)      tfdb_op_record(TFDB_OP_END, (ADDR), (API), (RESULT))
+#else
+    #define tfdb_read(index, addr, buf, size)       tfdb_flash_read(TFDB_DEV(index), (addr), (buf), (size))
+    #define tfdb_erase(index, addr, size)           tfdb_flash_erase(TFDB_DEV(index), (addr), (size))
+    #define tfdb_write(index, addr, buf, size)      tfdb_flash_write(TFDB_DEV(index), (addr), (buf), (size))
+    #define TFDB_RECORD_BEGIN(API, ADDR)
+    #define TFDB_RECORD_END(API, ADDR, RESULT)
+#endif
+
+/* flash_size / value_len / end_byte, it's 8 bytes when write unit is 8. */
+#define TFDB_HDR_SIZE(index)                        ((TFDB_WRITE_UNIT(index) == 8) ? 8 : 4)
+
+/* end_byte in header with the tags of record layout. */
+#if TFDB_USE_COMPRESS
+    #define TFDB_HDR_END_BYTE(index)                ((index)->end_byte ^ ((index)->compress ? TFDB_HDR_TAG_COMPRESS : TFDB_HDR_LAYOUT_TAG))
+#else
+    #define TFDB_HDR_END_BYTE(index)                ((index)->end_byte ^ TFDB_HDR_LAYOUT_TAG)
+#endif
+
+#if TFDB_USE_SLOT_MARKER
+    /* every marker takes one write unit after header. */
+    #define TFDB_MARKER_SIZE(index)                 (TFDB_SLOT_MARKER_NUM * TFDB_WRITE_UNIT(index))
+#else
+    #define TFDB_MARKER_SIZE(index)                 0
+#endif
+
+/* the offset of the first record in flash block. */
+#define TFDB_DATA_OFFSET(index)                     (TFDB_HDR_SIZE(index) + TFDB_MARKER_SIZE(index))
+
+/**
+ * get the size which is aligned with write unit of index.
+ *
+ * @param index the data manage index.
+ * @param size the size need to be aligned.
+ *
+ * @return uint16_t
+ */
+static uint16_t tfdb_aligned_size(const tfdb_index_t *index, uint16_t size)
+{
+    /* index is only used by TFDB_WRITE_UNIT with TFDB_USE_DEVICE. */
+    (void)index;
+    return ((size + TFDB_WRITE_UNIT(index) - 1) & ~(TFDB_WRITE_UNIT(index) - 1));
+}
+
+/**
+ * get the aligned size of the record in flash block.
+ *
+ * @param index the data manage index.
+ *
+ * @return uint16_t
+ */
+static uint16_t tfdb_record_size(const tfdb_index_t *index)
+{
+    /* data + verify + ecc + end_byte */
+    return tfdb_aligned_size(index, index->value_length + 2 + TFDB_ECC_SIZE);
+}
+
+#if TFDB_USE_ECC
+
+static uint32_t tfdb_ecc_corrected_count = 0;
+
+/**
+ * get the number of set bits.
+ *
+ * @param value the value to count.
+ *
+ * @return uint8_t
+ */
+static uint8_t tfdb_bit_count(uint16_t value)
+{
+    uint8_t count = 0;
+    while (value != 0)
+    {
+        value &= (value - 1);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * calculate hamming SECDED code of data.
+ * every data bit takes a hamming position which is not power of 2, starts at 3.
+ * bit0-11 are the hamming check bits, bit12-14 are always 0, bit15 is the overall parity.
+ *
+ * @param data the data to protect.
+ * @param size the size of data, max 256 bytes.
+ *
+ * @return uint16_t
+ */
+static uint16_t tfdb_ecc_calc(const uint8_t *data, uint16_t size)
+{
+    uint16_t check = 0;
+    uint16_t pos = 3;
+    uint8_t parity = 0;
+    uint16_t i;
+    uint8_t bit;
+
+    for (i = 0; i < size; i++)
+    {
+        for (bit = 0; bit < 8; bit++)
+        {
+            if (data[i] & (1 << bit))
+            {
+                check ^= pos;
+                parity ^= 1;
+            }
+            pos++;
+            if ((pos & (pos - 1)) == 0)
+            {
+                /* power of 2 is position of check bit. */
+                pos++;
+            }
+        }
+    }
+    parity ^= (tfdb_bit_count(check) & 0x01);
+    return (check | ((uint16_t)parity << 15));
+}
+
+/**
+ * check data with hamming SECDED code, correct one bit error in place.
+ *
+ * @param data the data to check.
+ * @param size the size of data.
+ * @param ecc the code saved in flash.
+ *
+ * @return uint8_t 0 means no error, 1 means corrected, 0xff means not correctable.
+ */
+static uint8_t tfdb_ecc_correct(uint8_t *data, uint16_t size, uint16_t ecc)
+{
+    uint16_t calc;
+    uint16_t syndrome;
+    uint16_t bit_index;
+    uint16_t log2 = 0;
+
+    calc = tfdb_ecc_calc(data, size);
+    syndrome = (calc ^ ecc) & 0x7fff;
+    if ((calc ^ ecc) == 0)
+    {
+        return 0;
+    }
+    if (((tfdb_bit_count(syndrome) + ((calc ^ ecc) >> 15)) & 0x01) == 0)
+    {
+        /* overall parity is right but syndrome is not 0, two bits error. */
+        return 0xff;
+    }
+    if ((syndrome & (syndrome - 1)) != 0)
+    {
+        /* the error is in data bit, convert hamming position to data bit index. */
+        while ((syndrome >> (log2 + 1)) != 0)
+        {
+            log2++;
+        }
+        bit_index = syndrome - log2 - 2;
+        if (bit_index >= (size * 8))
+        {
+            return 0xff;
+        }
+        data[bit_index >> 3] ^= (1 << (bit_index & 0x07));
+    }
+    /* else the error is in check bits, data is right. */
+    tfdb_ecc_corrected_count++;
+    return 1;
+}
+
+/**
+ * get the number of bit errors corrected by ecc since power on or last clear.
+ *
+ * @return uint32_t
+ */
+uint32_t tfdb_ecc_get_corrected(void)
+{
+    return tfdb_ecc_corrected_count;
+}
+
+/**
+ * clear the number of bit errors corrected by ecc.
+ */
+void tfdb_ecc_clear_corrected(void)
+{
+    tfdb_ecc_corrected_count = 0;
+}
+
+#endif /* TFDB_USE_ECC */
+
+#if TFDB_USE_MIRROR
+
+/**
+ * check if the value can be copied from mirror, the flash is read every TFDB_MIRROR_VERIFY_PERIOD times.
+ *
+ * @param mirror the RAM mirror of value.
+ *
+ * @return uint8_t 1 means the value in mirror can be used.
+ */
+static uint8_t tfdb_mirror_hit(tfdb_mirror_t *mirror)
+{
+    if (mirror->valid == 0)
+    {
+        return 0;
+    }
+#if TFDB_MIRROR_VERIFY_PERIOD
+    mirror->hits++;
+    if (mirror->hits >= TFDB_MIRROR_VERIFY_PERIOD)
+    {
+        /* verify mirror with flash this time. */
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+/**
+ * save value to mirror, the mirror is invalid when result is not TFDB_NO_ERR.
+ *
+ * @param mirror the RAM mirror of value.
+ * @param result the result of flash operation.
+ * @param value the value in flash.
+ * @param size the size of value.
+ */
+static void tfdb_mirror_set(tfdb_mirror_t *mirror, TFDB_Err_Code result, const void *value, uint8_t size)
+{
+    mirror->hits = 0;
+    if (result == TFDB_NO_ERR)
+    {
+        tfdb_memcpy(mirror->value, value, size);
+        mirror->valid = 1;
+    }
+    else
+    {
+        mirror->valid = 0;
+    }
+}
+
+/**
+ * update mirror after reading flash, count the mismatch when mirror is valid but different to flash.
+ *
+ * @param mirror the RAM mirror of value.
+ * @param result the result of reading flash.
+ * @param value the value read from flash.
+ * @param size the size of value.
+ */
+static void tfdb_mirror_update(tfdb_mirror_t *mirror, TFDB_Err_Code result, const void *value, uint8_t size)
+{
+    if ((result == TFDB_NO_ERR) && mirror->valid && (tfdb_memcmp(mirror->value, value, size) != TFDB_MEMCMP_SAME))
+    {
+        /* flash is changed without tfdb_set, or RAM is broken. */
+        mirror->mismatch++;
+    }
+    tfdb_mirror_set(mirror, result, value, size);
+}
+
+#endif /* TFDB_USE_MIRROR */
+
+#if TFDB_USE_WRITE_BUDGET
+
+/**
+ * refill the tokens of budget by ticks, and take one token.
+ * period and capacity of budget must be checked not 0 before.
+ *
+ * @param budget the write budget of index.
+ *
+ * @return uint8_t 1 means the write can be done now.
+ */
+static uint8_t tfdb_budget_take(tfdb_budget_t *budget)
+{
+    uint32_t tick = tfdb_port_get_tick();
+    uint32_t refill;
+
+    if (budget->started == 0)
+    {
+        budget->started = 1;
+        budget->tokens = budget->capacity;
+        budget->last_tick = tick;
+    }
+    /* the tick may wrap around. */
+    refill = (uint32_t)(tick - budget->last_tick) / budget->period;
+    if (refill >= (uint32_t)(budget->capacity - budget->tokens))
+    {
+        budget->tokens = budget->capacity;
+        budget->last_tick = tick;
+    }
+    else
+    {
+        budget->tokens += (uint16_t)refill;
+        budget->last_tick += refill * budget->period;
+    }
+    if (budget->tokens == 0)
+    {
+        return 0;
+    }
+    budget->tokens--;
+    return 1;
+}
+
+#endif /* TFDB_USE_WRITE_BUDGET */
+
+#if TFDB_USE_OP_RECORD
+
+/**
+ * pack an operation to little endian record and pass it to tfdb_port_record.
+ *
+ * @param op the operation, TFDB_OP_xxx.
+ * @param addr the flash address, or flash_addr of index for api records.
+ * @param size the bytes size of operation, or api id for api records.
+ * @param result the result of operation.
+ */
+static void tfdb_op_record(uint8_t op, tfdb_addr_t addr, uint16_t size, uint8_t result)
+{
+    uint8_t record[TFDB_OP_RECORD_SIZE];
+    uint32_t tick;
+
+    tick = tfdb_port_get_tick();
+    record[0] = (uint8_t)tick;
+    record[1] = (uint8_t)(tick >> 8);
+    record[2] = (uint8_t)(tick >> 16);
+    record[3] = (uint8_t)(tick >> 24);
+    record[4] = (uint8_t)addr;
+    record[5] = (uint8_t)((uint32_t)addr >> 8);
+    record[6] = (uint8_t)((uint32_t)addr >> 16);
+    record[7] = (uint8_t)((uint32_t)addr >> 24);
+    record[8] = (uint8_t)size;
+    record[9] = (uint8_t)(size >> 8);
+    record[10] = op;
+    record[11] = result;
+    tfdb_port_record(record, TFDB_OP_RECORD_SIZE);
+}
+
+/* the records are written after operations, so the tick is taken when the operation is finished.
+ * dev is NULL without TFDB_USE_DEVICE. */
+
+static TFDB_Err_Code tfdb_op_read(const void *dev, tfdb_addr_t addr, uint8_t *buf, size_t size)
+{
+    TFDB_Err_Code result;
+    (void)dev;
+    result = tfdb_flash_read((const tfdb_dev_t *)dev, addr, buf, size);
+    tfdb_op_record(TFDB_OP_READ, addr, (uint16_t)size, (uint8_t)result);
+    return result;
+}
+
+static TFDB_Err_Code tfdb_op_erase(const void *dev, tfdb_addr_t addr, size_t size)
+{
+    TFDB_Err_Code result;
+    (void)dev;
+    result = tfdb_flash_erase((const tfdb_dev_t *)dev, addr, size);
+    tfdb_op_record(TFDB_OP_ERASE, addr, (uint16_t)size, (uint8_t)result);
+    return result;
+}
+
+static TFDB_Err_Code tfdb_op_write(const void *dev, tfdb_addr_t addr, const uint8_t *buf, size_t size)
+{
+    TFDB_Err_Code result;
+    (void)dev;
+    result = tfdb_flash_write((const tfdb_dev_t *)dev, addr, buf, size);
+    tfdb_op_record(TFDB_OP_WRITE, addr, (uint16_t)size, (uint8_t)result);
+    return result;
+}
+
+#endif /* TFDB_USE_OP_RECORD */
+
+/**
+ * check the end_byte of record.
+ * with ecc, one bit error is accepted when end_byte is far enough from the erased value.
+ *
+ * @param index the data manage index.
+ * @param end_byte the end_byte read from flash.
+ *
+ * @return uint8_t 1 means the end_byte is right.
+ */
+static uint8_t tfdb_end_byte_ok(const tfdb_index_t *index, uint8_t end_byte)
+{
+#if TFDB_USE_ECC
+    uint8_t diff = end_byte ^ index->end_byte;
+    if ((diff != 0) && ((diff & (diff - 1)) == 0) && (tfdb_bit_count(index->end_byte ^ TFDB_ERASED_BYTE(index)) >= 3))
+    {
+        return 1;
+    }
+#endif
+    return (end_byte == index->end_byte);
+}
+
+/**
+ * get the address of the last record slot in flash block.
+ *
+ * @param index the data manage index.
+ * @param aligned_value_size the aligned size of record.
+ *
+ * @return tfdb_addr_t
+ */
+static tfdb_addr_t tfdb_last_slot_addr(const tfdb_index_t *index, uint16_t aligned_value_size)
+{
+    return index->flash_addr + index->flash_size - ((index->flash_size - TFDB_DATA_OFFSET(index)) % aligned_value_size) - aligned_value_size;
+}
+
+#if TFDB_USE_BLANK_CHECK || TFDB_USE_BAD_SLOT || TFDB_USE_COMPRESS
+
+/**
+ * get the pattern of erased flash, the value_after_erase_size bytes of erased value are in the same order as the value in memory.
+ * the byte at addr is pattern[addr % size].
+ *
+ * @param index the data manage index.
+ * @param pattern buffer to save the pattern, must hold 4 bytes.
+ *
+ * @return uint8_t the size of pattern, 1/2/4.
+ */
+static uint8_t tfdb_erased_pattern(const tfdb_index_t *index, uint8_t *pattern)
+{
+    uint32_t value32;
+    uint16_t value16;
+#if TFDB_USE_DEVICE
+    uint32_t value = index->dev->value_after_erase;
+    uint8_t size = index->dev->value_after_erase_size;
+#else
+    uint32_t value = TFDB_VALUE_AFTER_ERASE;
+    uint8_t size = TFDB_VALUE_AFTER_ERASE_SIZE;
+
+    (void)index;
+#endif
+
+    if (size == 4)
+    {
+        value32 = value;
+        tfdb_memcpy(pattern, &value32, 4);
+    }
+    else if (size == 2)
+    {
+        value16 = (uint16_t)value;
+        tfdb_memcpy(pattern, &value16, 2);
+    }
+    else
+    {
+        pattern[0] = (uint8_t)value;
+        size = 1;
+    }
+    return size;
+}
+
+#endif /* TFDB_USE_BLANK_CHECK || TFDB_USE_BAD_SLOT || TFDB_USE_COMPRESS */
+
+#if TFDB_USE_BLANK_CHECK
+
+/**
+ * check if the flash is erased, the blank check command of device or port is used when it's supported,
+ * otherwise the flash is read to rw_buffer and compared with the pattern of value after erase.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store read data.
+ * @param buffer_size the size of rw_buffer can be used.
+ * @param addr flash address.
+ * @param size check bytes size.
+ * @param blank the pointer to save result, 1 means the flash is erased.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_blank_check(const tfdb_index_t *index, uint8_t *rw_buffer, uint16_t buffer_size, tfdb_addr_t addr, uint16_t size, uint8_t *blank)
+{
+#if TFDB_USE_DEVICE || (TFDB_USE_BLANK_CHECK == 1)
+    TFDB_Err_Code result;
+    uint16_t read_size;
+    uint16_t i;
+    uint8_t pattern[4];
+    uint8_t pattern_size;
+#endif
+
+    /* index is only used with TFDB_USE_DEVICE. */
+    (void)index;
+#if TFDB_USE_DEVICE
+    if ((index->dev->caps & TFDB_DEV_CAP_BLANK_CHECK) && (index->dev->blank_check != NULL))
+    {
+        return index->dev->blank_check(index->dev, addr, size, blank);
+    }
+#elif (TFDB_USE_BLANK_CHECK == 2)
+    (void)rw_buffer;
+    (void)buffer_size;
+    return tfdb_port_blank_check(addr, size, blank);
+#endif
+
+#if TFDB_USE_DEVICE || (TFDB_USE_BLANK_CHECK == 1)
+    pattern_size = tfdb_erased_pattern(index, pattern);
+    *blank = 1;
+    while (size != 0)
+    {
+        read_size = (size > buffer_size) ? buffer_size : size;
+        result = tfdb_read(index, addr, rw_buffer, read_size);
+        if (result != TFDB_NO_ERR)
+        {
+            TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, addr);
+            return result;
+        }
+        for (i = 0; i < read_size; i++)
+        {
+            if (rw_buffer[i] != pattern[(addr + i) % pattern_size])
+            {
+                *blank = 0;
+                return TFDB_NO_ERR;
+            }
+        }
+        addr += read_size;
+        size -= read_size;
+    }
+    return TFDB_NO_ERR;
+#endif
+}
+
+#endif /* TFDB_USE_BLANK_CHECK */
+
+#if TFDB_USE_SLOT_MARKER
+
+/**
+ * get the slot number of every marker group.
+ * the slots are divided to (TFDB_SLOT_MARKER_NUM + 1) groups, marker n is written before the first record of group n.
+ *
+ * @param index the data manage index.
+ * @param aligned_value_size the aligned size of record.
+ *
+ * @return uint16_t
+ */
+static uint16_t tfdb_marker_group_size(const tfdb_index_t *index, uint16_t aligned_value_size)
+{
+    uint16_t slots;
+
+    slots = (index->flash_size - TFDB_DATA_OFFSET(index)) / aligned_value_size;
+    return (slots + TFDB_SLOT_MARKER_NUM) / (TFDB_SLOT_MARKER_NUM + 1);
+}
+
+/**
+ * find the last slot which may have record by binary searching the markers.
+ * the markers are always written in order, so the written markers are continuous from marker 1.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store read data.
+ * @param aligned_value_size the aligned size of record.
+ * @param find_addr the pointer to save address of the last slot which may have record.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_marker_find(const tfdb_index_t *index, uint8_t *rw_buffer, uint16_t aligned_value_size, tfdb_addr_t *find_addr)
+{
+    TFDB_Err_Code result;
+    uint8_t low = 0;
+    uint8_t high = TFDB_SLOT_MARKER_NUM;
+    uint8_t mid;
+    tfdb_addr_t addr;
+
+    while (low < high)
+    {
+        mid = (low + high + 1) / 2;
+        addr = index->flash_addr + TFDB_HDR_SIZE(index) + (mid - 1) * TFDB_WRITE_UNIT(index);
+        result = tfdb_read(index, addr, rw_buffer, TFDB_WRITE_UNIT(index));
+        if (result != TFDB_NO_ERR)
+        {
+            TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, addr);
+            return result;
+        }
+        if (tfdb_end_byte_ok(index, rw_buffer[TFDB_WRITE_UNIT(index) - 1]))
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    TFDB_TRACE_DBG(TFDB_EVT_MARKER, low, index->flash_addr);
+
+    /* no record after the end of group low. */
+    *find_addr = index->flash_addr + TFDB_DATA_OFFSET(index) + ((uint32_t)(low + 1) * tfdb_marker_group_size(index, aligned_value_size) - 1) * aligned_value_size;
+    if (*find_addr > tfdb_last_slot_addr(index, aligned_value_size))
+    {
+        *find_addr = tfdb_last_slot_addr(index, aligned_value_size);
+    }
+    return TFDB_NO_ERR;
+}
+
+/**
+ * write the marker when the record is the first one of its group.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param aligned_value_size the aligned size of record.
+ * @param find_addr the address of record which will be written.
+ *
+ * @return TFDB_Err_Code TFDB_FLASH_ERR means the marker can't be written.
+ */
+static TFDB_Err_Code tfdb_marker_set(const tfdb_index_t *index, uint8_t *rw_buffer, uint16_t aligned_value_size, tfdb_addr_t find_addr)
+{
+    TFDB_Err_Code result;
+    uint16_t slot;
+    uint16_t group_size;
+    tfdb_addr_t addr;
+    uint8_t i;
+
+    slot = (find_addr - index->flash_addr - TFDB_DATA_OFFSET(index)) / aligned_value_size;
+    group_size = tfdb_marker_group_size(index, aligned_value_size);
+    if ((slot == 0) || ((slot % group_size) != 0))
+    {
+        /* the marker of this group is written before the records in front of it. */
+        return TFDB_NO_ERR;
+    }
+    addr = index->flash_addr + TFDB_HDR_SIZE(index) + (slot / group_size - 1) * TFDB_WRITE_UNIT(index);
+    for (i = 0; i < TFDB_WRITE_UNIT(index); i++)
+    {
+        rw_buffer[i] = index->end_byte;
+    }
+    result = tfdb_write(index, addr, rw_buffer, TFDB_WRITE_UNIT(index));
+    if (result != TFDB_NO_ERR)
+    {
+        TFDB_TRACE_ERR(TFDB_EVT_WRITE_ERR, result, addr);
+        return result;
+    }
+    result = tfdb_read(index, addr, rw_buffer, TFDB_WRITE_UNIT(index));
+    if (result != TFDB_NO_ERR)
+    {
+        TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, addr);
+        return result;
+    }
+    for (i = 0; i < TFDB_WRITE_UNIT(index); i++)
+    {
+        if (rw_buffer[i] != index->end_byte)
+        {
+            TFDB_TRACE_ERR(TFDB_EVT_WRITE_VERIFY_ERR, 0, addr);
+            return TFDB_FLASH_ERR;
+        }
+    }
+    return TFDB_NO_ERR;
+}
+
+#endif /* TFDB_USE_SLOT_MARKER */
+
+#if TFDB_USE_BAD_SLOT
+
+/**
+ * get the bit position of slot in bad map.
+ *
+ * @param index the data manage index.
+ * @param aligned_value_size the aligned size of record.
+ * @param find_addr the address of slot.
+ *
+ * @return uint32_t
+ */
+static uint32_t tfdb_bad_slot(const tfdb_index_t *index, uint16_t aligned_value_size, tfdb_addr_t find_addr)
+{
+    return (find_addr - index->flash_addr - TFDB_DATA_OFFSET(index)) / aligned_value_size;
+}
+
+/**
+ * check if the slot is marked bad.
+ *
+ * @param index the data manage index.
+ * @param aligned_value_size the aligned size of record.
+ * @param find_addr the address of slot.
+ *
+ * @return uint8_t 1 means the slot is bad.
+ */
+static uint8_t tfdb_bad_get(const tfdb_index_t *index, uint16_t aligned_value_size, tfdb_addr_t find_addr)
+{
+    uint32_t slot = tfdb_bad_slot(index, aligned_value_size, find_addr);
+
+    if ((index->bad == NULL) || (slot >= ((uint32_t)index->bad->map_size << 3)))
+    {
+        return 0;
+    }
+    return (index->bad->map[slot >> 3] >> (slot & 0x07)) & 0x01;
+}
+
+/**
+ * mark the slot bad.
+ *
+ * @param index the data manage index.
+ * @param aligned_value_size the aligned size of record.
+ * @param find_addr the address of slot.
+ */
+static void tfdb_bad_mark(const tfdb_index_t *index, uint16_t aligned_value_size, tfdb_addr_t find_addr)
+{
+    uint32_t slot = tfdb_bad_slot(index, aligned_value_size, find_addr);
+
+    if ((index->bad == NULL) || (slot >= ((uint32_t)index->bad->map_size << 3)))
+    {
+        return;
+    }
+    if ((index->bad->map[slot >> 3] & (1 << (slot & 0x07))) == 0)
+    {
+        index->bad->map[slot >> 3] |= (uint8_t)(1 << (slot & 0x07));
+        index->bad->count++;
+        TFDB_TRACE_INFO(TFDB_EVT_BAD_SLOT, 1, find_addr);
+    }
+}
+
+/**
+ * clear the bad slot map of index.
+ *
+ * @param index the data manage index.
+ */
+static void tfdb_bad_clear(const tfdb_index_t *index)
+{
+    uint16_t i;
+
+    if (index->bad == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < index->bad->map_size; i++)
+    {
+        index->bad->map[i] = 0;
+    }
+    index->bad->count = 0;
+}
+
+#endif /* TFDB_USE_BAD_SLOT */
+
+#if TFDB_TRACE_LEVEL
+
+static tfdb_trace_event_t tfdb_trace_buffer[TFDB_TRACE_BUFFER_SIZE];
+static uint16_t tfdb_trace_head = 0;     /* the count of written events */
+static uint16_t tfdb_trace_tail = 0;     /* the count of read events */
+static uint32_t tfdb_trace_lost_count = 0;
+
+/**
+ * write an event to trace ring buffer, the oldest event is dropped when the buffer is full.
+ * there is no lock, please read events in the same context or add lock by yourself.
+ *
+ * @param id the event id, TFDB_EVT_xxx.
+ * @param arg0 the first argument, usually the result.
+ * @param arg1 the second argument, usually the flash address.
+ */
+void tfdb_trace_write(uint16_t id, uint16_t arg0, uint32_t arg1)
+{
+    tfdb_trace_event_t *event;
+
+    if ((uint16_t)(tfdb_trace_head - tfdb_trace_tail) >= TFDB_TRACE_BUFFER_SIZE)
+    {
+        tfdb_trace_tail++;
+        tfdb_trace_lost_count++;
+    }
+    event = &tfdb_trace_buffer[tfdb_trace_head & (TFDB_TRACE_BUFFER_SIZE - 1)];
+    event->id = id;
+    event->arg0 = arg0;
+    event->arg1 = arg1;
+    tfdb_trace_head++;
+}
+
+/**
+ * read the oldest event from trace ring buffer, it can be called in idle task.
+ *
+ * @param event the pointer to save the event.
+ *
+ * @return uint8_t 1 means an event is read, 0 means the buffer is empty.
+ */
+uint8_t tfdb_trace_read(tfdb_trace_event_t *event)
+{
+    if (tfdb_trace_head == tfdb_trace_tail)
+    {
+        return 0;
+    }
+    *event = tfdb_trace_buffer[tfdb_trace_tail & (TFDB_TRACE_BUFFER_SIZE - 1)];
+    tfdb_trace_tail++;
+    return 1;
+}
+
+/**
+ * get the number of events dropped because the ring buffer is full.
+ *
+ * @return uint32_t
+ */
+uint32_t tfdb_trace_get_lost(void)
+{
+    return tfdb_trace_lost_count;
+}
+
+/**
+ * get the name of trace event, for decoding in idle task.
+ *
+ * @param id the event id.
+ *
+ * @return const char*
+ */
+const char *tfdb_trace_name(uint16_t id)
+{
+    static const char *const names[TFDB_EVT_MAX] =
+    {
+        "read err",
+        "write err",
+        "erase err",
+        "write verify err",
+        "sum err",
+        "ecc err",
+        "ecc corrected",
+        "end_byte err",
+        "check",
+        "init",
+        "hdr err",
+        "full",
+        "set",
+        "get",
+        "get_pre",
+        "dual judge",
+        "mount",
+        "mount all",
+        "marker",
+        "blank",
+        "blob set",
+        "blob get",
+        "budget",
+        "bad slot",
+        "compress",
+    };
+
+    if (id >= TFDB_EVT_MAX)
+    {
+        return "unknown";
+    }
+    return names[id];
+}
+
+#endif /* TFDB_TRACE_LEVEL */
+
+/**
+ * check header in flash.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_check(const tfdb_index_t *index, uint8_t *rw_buffer)
+{
+    TFDB_Err_Code result;
+
+    /* flash_size / value_len / end_byte */
+    result = tfdb_read(index, index->flash_addr, rw_buffer, TFDB_HDR_SIZE(index));
+    if (result != TFDB_NO_ERR)
+    {
+        //read err
+        TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, index->flash_addr);
+        goto end;
+    }
+    result = TFDB_HDR_ERR;
+    /* compare flash_size */
+    if ((rw_buffer[0] == ((index->flash_size >> 8) & 0xff)) && (rw_buffer[1] == ((index->flash_size) & 0xff)))
+    {
+        /* compare value_length and end_byte */
+        if ((rw_buffer[2] == index->value_length) && (rw_buffer[3] == TFDB_HDR_END_BYTE(index)))
+        {
+            /* check hdr success */
+            result = TFDB_NO_ERR;
+            goto end;
+        }
+    }
+end:
+    TFDB_TRACE_DBG(TFDB_EVT_CHECK, result, index->flash_addr);
+    return result;
+}
+
+/**
+ * erase the flash block and init header in flash.
+ * with TFDB_USE_BLANK_CHECK, the erasing is skipped when the flash block is erased already.
+ * with TFDB_USE_BAD_SLOT, the bad slot map is cleared, the slots are tried again after erasing.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_init(const tfdb_index_t *index, uint8_t *rw_buffer)
+{
+    TFDB_Err_Code result = TFDB_NO_ERR;
+    uint8_t i;
+#if TFDB_USE_BLANK_CHECK
+    uint8_t blank;
+
+    result = tfdb_blank_check(index, rw_buffer, tfdb_record_size(index), index->flash_addr, index->flash_size, &blank);
+    if (result != TFDB_NO_ERR)
+    {
+        goto end;
+    }
+    TFDB_TRACE_DBG(TFDB_EVT_BLANK, blank, index->flash_addr);
+    if (blank)
+    {
+        goto write_hdr;
+    }
+#endif
+
+    result = tfdb_erase(index, index->flash_addr, index->flash_size);
+    if (result != TFDB_NO_ERR)
+    {
+        //erase err
+        TFDB_TRACE_ERR(TFDB_EVT_ERASE_ERR, result, index->flash_addr);
+        goto end;
+    }
+#if TFDB_USE_BLANK_CHECK
+write_hdr:
+#endif
+#if TFDB_USE_BAD_SLOT
+    tfdb_bad_clear(index);
+#endif
+    rw_buffer[0] = ((index->flash_size >> 8) & 0xff);
+    rw_buffer[1] = ((index->flash_size) & 0xff);
+    rw_buffer[2] = index->value_length;
+    rw_buffer[3] = TFDB_HDR_END_BYTE(index);
+    for (i = 4; i < TFDB_HDR_SIZE(index); i++)
+    {
+        rw_buffer[i] = index->end_byte;
+    }
+    /* flash_size / value_len / end_byte */
+    result = tfdb_write(index, index->flash_addr, rw_buffer, TFDB_HDR_SIZE(index));
+    if (result != TFDB_NO_ERR)
+    {
+        //write err
+        TFDB_TRACE_ERR(TFDB_EVT_WRITE_ERR, result, index->flash_addr);
+        goto end;
+    }
+    result = tfdb_check(index, rw_buffer);
+    if (result != TFDB_NO_ERR)
+    {
+        result = TFDB_FLASH_ERR;
+        goto end;
+    }
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_INIT, result, index->flash_addr);
+    return result;
+}
+
+/**
+ * set data in flash and save the addr to addr_cache.
+ * the record is built in rw_buffer directly, head bytes first and value_from after them.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param addr_cache the pointer to addr which is user offered, which will save read addr.
+ * @param head the bytes placed before value_from in the record, can be NULL when head_len is 0.
+ * @param head_len the length of head, value_from holds the other (value_length - head_len) bytes.
+ * @param value_from the pointer to buffer which is user offered that need to save.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_set_record(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, const uint8_t *head, uint8_t head_len, const void *value_from)
+{
+    TFDB_Err_Code result;
+    tfdb_addr_t find_addr;
+    uint16_t aligned_value_size;
+    uint8_t sum_verify_byte;
+    uint8_t value_len;
+    uint16_t i;
+#if TFDB_USE_ECC
+    uint16_t ecc;
+#endif
+#if TFDB_WRITE_MAX_RETRY
+    uint32_t max_retry = 0;
+#endif
+#if TFDB_USE_BLANK_CHECK
+    uint8_t blank;
+#endif
+#if TFDB_USE_BLANK_CHECK || TFDB_USE_BAD_SLOT
+    uint8_t erased = 0;
+#endif
+
+
+    aligned_value_size  = tfdb_record_size(index);
+    value_len = index->value_length - head_len;
+
+    if (addr_cache == NULL)
+    {
+start:
+        /* addr_cache is not init. so check header first. */
+        find_addr = 0;
+        result = tfdb_get(index, rw_buffer, &find_addr, NULL);
+        if(result == TFDB_NO_ERR)
+        {
+            find_addr = find_addr + aligned_value_size;
+            if (find_addr > tfdb_last_slot_addr(index, aligned_value_size))
+            {
+                /* the flash block is fill */
+                TFDB_TRACE_INFO(TFDB_EVT_FULL, 0, index->flash_addr);
+                goto init;
+            }
+
+            /* find the addr success */
+set:
+            /* calculate sum verify */
+            sum_verify_byte = 0xff;
+            for (i = 0; i < head_len; i++)
+            {
+                sum_verify_byte = ((sum_verify_byte + head[i]) & 0xff);
+            }
+            for (i = 0; i < value_len; i++)
+            {
+                sum_verify_byte = ((sum_verify_byte + ((const uint8_t *)(value_from))[i]) & 0xff);
+            }
+write:
+#if TFDB_WRITE_MAX_RETRY
+            max_retry++;
+            if (max_retry > TFDB_WRITE_MAX_RETRY)
+            {
+                result = TFDB_FLASH_ERR;
+                goto end;
+            }
+#endif
+#if TFDB_USE_SLOT_MARKER
+            result = tfdb_marker_set(index, rw_buffer, aligned_value_size, find_addr);
+            if (result == TFDB_FLASH_ERR)
+            {
+                /* the marker is broken, tfdb_get can't find records after it, so erase the flash block. */
+                goto init;
+            }
+            else if (result != TFDB_NO_ERR)
+            {
+                goto end;
+            }
+#endif
+#if TFDB_USE_BAD_SLOT
+            /* after the marker, so the marker of the group is written even if the first slot is skipped. */
+            if (tfdb_bad_get(index, aligned_value_size, find_addr))
+            {
+                TFDB_TRACE_DBG(TFDB_EVT_BAD_SLOT, 0, find_addr);
+#if TFDB_WRITE_MAX_RETRY
+                /* the slot is not programmed, so it's not a retry. */
+                max_retry--;
+#endif
+                goto next_slot;
+            }
+#endif
+#if TFDB_USE_BLANK_CHECK
+            /* after the marker, so the marker of the group is written even if the first slot is skipped. */
+            result = tfdb_blank_check(index, rw_buffer, aligned_value_size, find_addr, aligned_value_size, &blank);
+            if (result != TFDB_NO_ERR)
+            {
+                goto end;
+            }
+            if (blank == 0)
+            {
+                /* the slot is dirty, don't program it. */
+                TFDB_TRACE_DBG(TFDB_EVT_BLANK, blank, find_addr);
+#if TFDB_WRITE_MAX_RETRY
+                /* the slot is not programmed, so it's not a retry. */
+                max_retry--;
+#endif
+                goto next_slot;
+            }
+#endif
+            for (i = 0; i < head_len; i++)
+            {
+                rw_buffer[i] = head[i];
+            }
+            tfdb_memcpy(&(rw_buffer[head_len]), value_from, value_len);
+            rw_buffer[index->value_length] = sum_verify_byte;
+#if TFDB_USE_ECC
+            ecc = tfdb_ecc_calc(rw_buffer, index->value_length + 1);
+            rw_buffer[index->value_length + 1] = (uint8_t)(ecc >> 8);
+            rw_buffer[index->value_length + 2] = (uint8_t)ecc;
+#endif
+            for (i = index->value_length + 1 + TFDB_ECC_SIZE; i < aligned_value_size; i++)
+            {
+                /* fill aligned data with end_byte */
+                rw_buffer[i] = index->end_byte;
+            }
+            result = tfdb_write(index, find_addr, rw_buffer, aligned_value_size);
+            if (result != TFDB_NO_ERR)
+            {
+                TFDB_TRACE_ERR(TFDB_EVT_WRITE_ERR, result, find_addr);
+                goto end;
+            }
+            result = tfdb_read(index, find_addr, rw_buffer, aligned_value_size);
+            if (result != TFDB_NO_ERR)
+            {
+                TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, find_addr);
+                goto end;
+            }
+            for (i = 0; i < head_len; i++)
+            {
+                if (rw_buffer[i] != head[i])
+                {
+                    break;
+                }
+            }
+            if ((i != head_len)
+                    || (tfdb_memcmp(&(rw_buffer[head_len]), value_from, value_len) != TFDB_MEMCMP_SAME)
+                    || (rw_buffer[index->value_length] != sum_verify_byte)
+#if TFDB_USE_ECC
+                    || (rw_buffer[index->value_length + 1] != (uint8_t)(ecc >> 8))
+                    || (rw_buffer[index->value_length + 2] != (uint8_t)ecc)
+#endif
+                    || (rw_buffer[aligned_value_size - 1] != index->end_byte))
+            {
+                /* write verify failed, maybe the flash is error, try next address. */
+                TFDB_TRACE_ERR(TFDB_EVT_WRITE_VERIFY_ERR, 0, find_addr);
+#if TFDB_USE_BAD_SLOT
+                tfdb_bad_mark(index, aligned_value_size, find_addr);
+#endif
+#if TFDB_USE_BLANK_CHECK || TFDB_USE_BAD_SLOT
+next_slot:
+#endif
+                find_addr += aligned_value_size;
+
+                if (find_addr > tfdb_last_slot_addr(index, aligned_value_size))
+                {
+                    /* the flash is fill */
+                    TFDB_TRACE_INFO(TFDB_EVT_FULL, 0, index->flash_addr);
+#if TFDB_USE_BLANK_CHECK || TFDB_USE_BAD_SLOT
+                    if (erased)
+                    {
+                        /* the slots are still skipped after erasing, the flash block is worn out. */
+                        result = TFDB_FLASH_ERR;
+                        goto end;
+                    }
+#endif
+                    goto init;
+                }
+                else
+                {
+                    goto write;
+                }
+            }
+            else
+            {
+                /* write data to flash success */
+                /* save addr to addr_cache */
+                if (addr_cache != NULL)
+                {
+                    *addr_cache = find_addr;
+                }
+            }
+        }
+        else if (result == TFDB_HDR_ERR)
+        {
+            TFDB_TRACE_INFO(TFDB_EVT_HDR_ERR, 0, index->flash_addr);
+init:
+#if TFDB_USE_BLANK_CHECK || TFDB_USE_BAD_SLOT
+            /* skipping slots can fill the flash block only once in a set. */
+            erased = 1;
+#endif
+            result = tfdb_init(index, rw_buffer);
+            if (result == TFDB_NO_ERR)
+            {
+after_init:
+                find_addr = index->flash_addr + TFDB_DATA_OFFSET(index);
+                goto set;
+            }
+            goto end;
+        }
+        else if (result == TFDB_NO_DATA)
+        {
+            goto after_init;
+        }
+    }
+    else
+    {
+        if (*addr_cache == 0)
+        {
+            /* addr_cache is not set */
+            goto start;
+        }
+        else
+        {
+            /* addr_cache is set */
+            find_addr = *addr_cache + aligned_value_size;
+            if (find_addr > (index->flash_addr + index->flash_size - aligned_value_size))
+            {
+                /* the flash is fill */
+                TFDB_TRACE_INFO(TFDB_EVT_FULL, 0, index->flash_addr);
+                goto init;
+            }
+            else
+            {
+                goto set;
+            }
+        }
+    }
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_SET, result, index->flash_addr);
+    return result;
+}
+
+#if TFDB_USE_COMPRESS
+
+/**
+ * encode value with RLE, control byte 0x80 | (n - 3) is followed by one byte repeated n times(3~130),
+ * control byte (n - 1) is followed by n literal bytes(1~128).
+ * value is copied when the encoded data is not shorter than value, so the length of encoded data is value_length.
+ *
+ * @param value the value need to be encoded.
+ * @param size the size of value.
+ * @param out buffer to save encoded data, must hold size bytes.
+ *
+ * @return uint8_t the length of encoded data.
+ */
+static uint8_t tfdb_rle_encode(const uint8_t *value, uint8_t size, uint8_t *out)
+{
+    uint16_t in_pos = 0;
+    uint16_t out_pos = 0;
+    uint16_t ctrl_pos = 0;
+    uint8_t literal = 0;
+    uint8_t run;
+
+    while (in_pos < size)
+    {
+        run = 1;
+        while (((in_pos + run) < size) && (value[in_pos + run] == value[in_pos]) && (run < 130))
+        {
+            run++;
+        }
+        if (run >= 3)
+        {
+            if ((out_pos + 2) >= size)
+            {
+                goto copy;
+            }
+            out[out_pos++] = (uint8_t)(0x80 | (run - 3));
+            out[out_pos++] = value[in_pos];
+            in_pos += run;
+            literal = 0;
+        }
+        else
+        {
+            if ((literal == 0) || (literal == 128))
+            {
+                if ((out_pos + 2) >= size)
+                {
+                    goto copy;
+                }
+                ctrl_pos = out_pos;
+                out[out_pos++] = 0;
+                literal = 0;
+            }
+            else if ((out_pos + 1) >= size)
+            {
+                goto copy;
+            }
+            out[ctrl_pos] = literal;
+            out[out_pos++] = value[in_pos++];
+            literal++;
+        }
+    }
+    return (uint8_t)out_pos;
+
+copy:
+    tfdb_memcpy(out, value, size);
+    return size;
+}
+
+/**
+ * decode RLE data, the decoded bytes are saved to value_to or compared with value_cmp, both can be NULL.
+ *
+ * @param in the encoded data.
+ * @param in_size the length of encoded data.
+ * @param value_to buffer to save value, NULL will not save.
+ * @param value_cmp the value to compare with, NULL will not compare.
+ * @param size the size of value.
+ *
+ * @return uint8_t 1 means the encoded data is right and same to value_cmp.
+ */
+static uint8_t tfdb_rle_decode(const uint8_t *in, uint8_t in_size, uint8_t *value_to, const uint8_t *value_cmp, uint8_t size)
+{
+    uint16_t in_pos = 0;
+    uint16_t out_pos = 0;
+    uint16_t count;
+    uint8_t repeat;
+    uint8_t byte;
+
+    while (in_pos < in_size)
+    {
+        if (in_size == size)
+        {
+            /* the value is not encoded. */
+            count = size;
+            repeat = 0;
+        }
+        else if (in[in_pos] & 0x80)
+        {
+            count = (in[in_pos++] & 0x7f) + 3;
+            repeat = 1;
+        }
+        else
+        {
+            count = in[in_pos++] + 1;
+            repeat = 0;
+        }
+        if (((in_pos + (repeat ? 1 : count)) > in_size) || ((out_pos + count) > size))
+        {
+            return 0;
+        }
+        while (count--)
+        {
+            byte = in[in_pos];
+            if (repeat == 0)
+            {
+                in_pos++;
+            }
+            if ((value_cmp != NULL) && (value_cmp[out_pos] != byte))
+            {
+                return 0;
+            }
+            if (value_to != NULL)
+            {
+                value_to[out_pos] = byte;
+            }
+            out_pos++;
+        }
+        if (repeat)
+        {
+            in_pos++;
+        }
+    }
+    return (out_pos == size);
+}
+
+/**
+ * read and verify the compressed record at find_addr.
+ * record: encoded length / encoded data / sum verify / end_byte filled / end_byte.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store read data.
+ * @param find_addr the address of record.
+ * @param record_size the aligned size of record, 0 means the length is broken or the flash is blank.
+ *
+ * @return TFDB_Err_Code TFDB_NO_DATA when the record is not right.
+ */
+static TFDB_Err_Code tfdb_compress_read(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t find_addr, uint16_t *record_size)
+{
+    TFDB_Err_Code result;
+    uint8_t sum_verify_byte;
+    uint8_t encoded_len;
+    uint16_t size;
+    uint16_t i;
+
+    *record_size = 0;
+    result = tfdb_read(index, find_addr, rw_buffer, TFDB_WRITE_UNIT(index));
+    if (result != TFDB_NO_ERR)
+    {
+        TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, find_addr);
+        return result;
+    }
+    encoded_len = rw_buffer[0];
+    if ((encoded_len == 0) || (encoded_len > index->value_length))
+    {
+        return TFDB_NO_DATA;
+    }
+    size = tfdb_aligned_size(index, encoded_len + 3);
+    if ((find_addr + size) > (index->flash_addr + index->flash_size))
+    {
+        return TFDB_NO_DATA;
+    }
+    *record_size = size;
+    if (size > TFDB_WRITE_UNIT(index))
+    {
+        result = tfdb_read(index, find_addr + TFDB_WRITE_UNIT(index), &rw_buffer[TFDB_WRITE_UNIT(index)], size - TFDB_WRITE_UNIT(index));
+        if (result != TFDB_NO_ERR)
+        {
+            TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, find_addr);
+            return result;
+        }
+    }
+    if (rw_buffer[size - 1] != index->end_byte)
+    {
+        TFDB_TRACE_DBG(TFDB_EVT_END_BYTE_ERR, rw_buffer[size - 1], find_addr);
+        return TFDB_NO_DATA;
+    }
+    sum_verify_byte = 0xff;
+    for (i = 0; i <= encoded_len; i++)
+    {
+        sum_verify_byte = ((sum_verify_byte + rw_buffer[i]) & 0xff);
+    }
+    if (sum_verify_byte != rw_buffer[encoded_len + 1])
+    {
+        TFDB_TRACE_ERR(TFDB_EVT_SUM_ERR, (sum_verify_byte << 8) | rw_buffer[encoded_len + 1], find_addr);
+        return TFDB_NO_DATA;
+    }
+    if (tfdb_rle_decode(&rw_buffer[1], encoded_len, NULL, NULL, index->value_length) == 0)
+    {
+        return TFDB_NO_DATA;
+    }
+    return TFDB_NO_ERR;
+}
+
+/**
+ * find records before end_addr by forward scan, the records are variable length.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store read data.
+ * @param end_addr stop scan at this address, 0 will scan the whole flash block.
+ * @param last_addr the address of last right record, 0 when no record.
+ * @param pre_addr the address of right record before last_addr, 0 when no record.
+ * @param next_addr the address to write new record, 0 when the flash after records is not blank.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_compress_scan(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t end_addr, tfdb_addr_t *last_addr, tfdb_addr_t *pre_addr, tfdb_addr_t *next_addr)
+{
+    TFDB_Err_Code result;
+    tfdb_addr_t find_addr;
+    uint16_t record_size;
+    uint8_t pattern[4];
+    uint8_t pattern_size;
+    uint8_t i;
+
+    *last_addr = 0;
+    *pre_addr = 0;
+    *next_addr = 0;
+    result = tfdb_check(index, rw_buffer);
+    if (result != TFDB_NO_ERR)
+    {
+        TFDB_TRACE_INFO(TFDB_EVT_HDR_ERR, 0, index->flash_addr);
+        return result;
+    }
+    if (end_addr == 0)
+    {
+        end_addr = index->flash_addr + index->flash_size;
+    }
+    find_addr = index->flash_addr + TFDB_HDR_SIZE(index);
+    while ((find_addr + TFDB_WRITE_UNIT(index)) <= end_addr)
+    {
+        result = tfdb_compress_read(index, rw_buffer, find_addr, &record_size);
+        if (result == TFDB_NO_ERR)
+        {
+            *pre_addr = *last_addr;
+            *last_addr = find_addr;
+        }
+        else if (result != TFDB_NO_DATA)
+        {
+            return result;
+        }
+        if (record_size == 0)
+        {
+            pattern_size = tfdb_erased_pattern(index, pattern);
+            for (i = 0; i < TFDB_WRITE_UNIT(index); i++)
+            {
+                if (rw_buffer[i] != pattern[(find_addr + i) % pattern_size])
+                {
+                    /* the length is broken, the records after it can't be found. */
+                    return TFDB_NO_ERR;
+                }
+            }
+            break;
+        }
+        find_addr += record_size;
+    }
+    *next_addr = find_addr;
+    return TFDB_NO_ERR;
+}
+
+/**
+ * get the compressed data in flash and save the addr of data to addr_cache.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store read data.
+ * @param addr_cache the pointer to addr which is user offered.
+ * @param value_to the pointer to buffer which is user offered to save data.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_compress_get(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, void *value_to)
+{
+    TFDB_Err_Code result;
+    tfdb_addr_t find_addr = 0;
+    tfdb_addr_t pre_addr;
+    tfdb_addr_t next_addr;
+    uint16_t record_size;
+
+    if (index->value_length == 0xff)
+    {
+        /* the length of encoded data may be same to TFDB_VALUE_AFTER_ERASE. */
+        result = TFDB_PARAM_ERR;
+        goto end;
+    }
+    if ((addr_cache != NULL) && (*addr_cache != 0))
+    {
+        find_addr = *addr_cache;
+        result = tfdb_compress_read(index, rw_buffer, find_addr, &record_size);
+        if (result == TFDB_NO_ERR)
+        {
+            goto decode;
+        }
+        else if (result != TFDB_NO_DATA)
+        {
+            goto end;
+        }
+    }
+    result = tfdb_compress_scan(index, rw_buffer, 0, &find_addr, &pre_addr, &next_addr);
+    if (result != TFDB_NO_ERR)
+    {
+        goto end;
+    }
+    if (find_addr == 0)
+    {
+        result = TFDB_NO_DATA;
+        goto end;
+    }
+    result = tfdb_compress_read(index, rw_buffer, find_addr, &record_size);
+    if (result != TFDB_NO_ERR)
+    {
+        goto end;
+    }
+decode:
+    if (value_to != NULL)
+    {
+        tfdb_rle_decode(&rw_buffer[1], rw_buffer[0], value_to, NULL, index->value_length);
+    }
+    if (addr_cache != NULL)
+    {
+        *addr_cache = find_addr;
+    }
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_GET, result, index->flash_addr);
+    return result;
+}
+
+/**
+ * set the compressed data in flash and save the addr to addr_cache.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param addr_cache the pointer to addr which is user offered, which will save read addr.
+ * @param value_from the pointer to buffer which is user offered that need to save.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_compress_set(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, const void *value_from)
+{
+    TFDB_Err_Code result;
+    tfdb_addr_t find_addr = 0;
+    tfdb_addr_t last_addr;
+    tfdb_addr_t pre_addr;
+    uint16_t record_size;
+    uint8_t encoded_len;
+    uint8_t sum_verify_byte;
+    uint16_t i;
+#if TFDB_WRITE_MAX_RETRY
+    uint32_t max_retry = 0;
+#endif
+
+    if (index->value_length == 0xff)
+    {
+        /* the length of encoded data may be same to TFDB_VALUE_AFTER_ERASE. */
+        result = TFDB_PARAM_ERR;
+        goto end;
+    }
+    if ((addr_cache != NULL) && (*addr_cache != 0))
+    {
+        result = tfdb_compress_read(index, rw_buffer, *addr_cache, &record_size);
+        if ((result != TFDB_NO_ERR) && (result != TFDB_NO_DATA))
+        {
+            goto end;
+        }
+        if (record_size != 0)
+        {
+            find_addr = *addr_cache + record_size;
+        }
+    }
+    if (find_addr == 0)
+    {
+scan:
+        result = tfdb_compress_scan(index, rw_buffer, 0, &last_addr, &pre_addr, &find_addr);
+        if (result == TFDB_HDR_ERR)
+        {
+            goto init;
+        }
+        else if (result != TFDB_NO_ERR)
+        {
+            goto end;
+        }
+        if (find_addr == 0)
+        {
+            /* the flash after records is broken. */
+            goto init;
+        }
+    }
+
+write:
+#if TFDB_WRITE_MAX_RETRY
+    max_retry++;
+    if (max_retry > TFDB_WRITE_MAX_RETRY)
+    {
+        result = TFDB_FLASH_ERR;
+        goto end;
+    }
+#endif
+    encoded_len = tfdb_rle_encode((const uint8_t *)value_from, index->value_length, &rw_buffer[1]);
+    rw_buffer[0] = encoded_len;
+    record_size = tfdb_aligned_size(index, encoded_len + 3);
+    if ((find_addr + record_size) > (index->flash_addr + index->flash_size))
+    {
+        /* the flash block is fill */
+        TFDB_TRACE_INFO(TFDB_EVT_FULL, 0, index->flash_addr);
+init:
+        result = tfdb_init(index, rw_buffer);
+        if (result != TFDB_NO_ERR)
+        {
+            goto end;
+        }
+        find_addr = index->flash_addr + TFDB_HDR_SIZE(index);
+        goto write;
+    }
+    TFDB_TRACE_DBG(TFDB_EVT_COMPRESS, encoded_len, find_addr);
+    sum_verify_byte = 0xff;
+    for (i = 0; i <= encoded_len; i++)
+    {
+        sum_verify_byte = ((sum_verify_byte + rw_buffer[i]) & 0xff);
+    }
+    rw_buffer[encoded_len + 1] = sum_verify_byte;
+    for (i = encoded_len + 2; i < record_size; i++)
+    {
+        /* fill aligned data with end_byte */
+        rw_buffer[i] = index->end_byte;
+    }
+    result = tfdb_write(index, find_addr, rw_buffer, record_size);
+    if (result != TFDB_NO_ERR)
+    {
+        TFDB_TRACE_ERR(TFDB_EVT_WRITE_ERR, result, find_addr);
+        goto end;
+    }
+    result = tfdb_compress_read(index, rw_buffer, find_addr, &i);
+    if ((result == TFDB_NO_ERR) && (rw_buffer[0] == encoded_len)
+            && tfdb_rle_decode(&rw_buffer[1], encoded_len, NULL, (const uint8_t *)value_from, index->value_length))
+    {
+        /* write data to flash success */
+        if (addr_cache != NULL)
+        {
+            *addr_cache = find_addr;
+        }
+        goto end;
+    }
+    else if ((result != TFDB_NO_ERR) && (result != TFDB_NO_DATA))
+    {
+        goto end;
+    }
+    /* write verify failed, maybe the flash is error, try next address. */
+    TFDB_TRACE_ERR(TFDB_EVT_WRITE_VERIFY_ERR, 0, find_addr);
+    if (rw_buffer[0] != encoded_len)
+    {
+        /* the flash is not blank or the length is broken, find the address again. */
+        goto scan;
+    }
+    find_addr += record_size;
+    goto write;
+
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_SET, result, index->flash_addr);
+    return result;
+}
+
+/**
+ * get the previous compressed data in flash.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store read data.
+ * @param addr_cache the pointer to addr which is user offered.
+ * @param pre_addr_cache the pointer to addr which will save the addr of previous data.
+ * @param value_to the pointer to buffer which is user offered to save data.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_compress_get_pre(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, tfdb_addr_t *pre_addr_cache, void *value_to)
+{
+    TFDB_Err_Code result;
+    tfdb_addr_t last_addr;
+    tfdb_addr_t pre_addr;
+    tfdb_addr_t next_addr;
+    uint16_t record_size;
+
+    if (index->value_length == 0xff)
+    {
+        return TFDB_PARAM_ERR;
+    }
+    if ((addr_cache != NULL) && (*addr_cache != 0))
+    {
+        /* the last record before addr_cache is the previous one. */
+        result = tfdb_compress_scan(index, rw_buffer, *addr_cache, &pre_addr, &last_addr, &next_addr);
+        if (result != TFDB_NO_ERR)
+        {
+            return result;
+        }
+    }
+    else
+    {
+        result = tfdb_compress_scan(index, rw_buffer, 0, &last_addr, &pre_addr, &next_addr);
+        if (result != TFDB_NO_ERR)
+        {
+            return result;
+        }
+        if (last_addr == 0)
+        {
+            return TFDB_NO_DATA;
+        }
+        if (addr_cache != NULL)
+        {
+            *addr_cache = last_addr;
+        }
+    }
+    if (pre_addr == 0)
+    {
+        /* no old data. */
+        return TFDB_NO_PRE_DATA;
+    }
+    result = tfdb_compress_read(index, rw_buffer, pre_addr, &record_size);
+    if (result != TFDB_NO_ERR)
+    {
+        return result;
+    }
+    if (value_to != NULL)
+    {
+        tfdb_rle_decode(&rw_buffer[1], rw_buffer[0], value_to, NULL, index->value_length);
+    }
+    if (pre_addr_cache != NULL)
+    {
+        *pre_addr_cache = pre_addr;
+    }
+    return TFDB_NO_ERR;
+}
+
+#endif /* TFDB_USE_COMPRESS */
+
+/**
+ * set value by the record type of index.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param addr_cache the pointer to addr which is user offered, which will save read addr.
+ * @param value_from the pointer to buffer which is user offered that need to save.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_set_value(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, const void *value_from)
+{
+#if TFDB_USE_COMPRESS
+    if (index->compress)
+    {
+        return tfdb_compress_set(index, rw_buffer, addr_cache, value_from);
+    }
+#endif
+    return tfdb_set_record(index, rw_buffer, addr_cache, NULL, 0, value_from);
+}
+
+/**
+ * set data in flash and save the addr to addr_cache.
+ * when index has a budget and no write is left, the value is saved to pending buffer of budget,
+ * or TFDB_BUDGET_ERR is returned if pending buffer is NULL.
+ * TFDB_PARAM_ERR is returned when period or capacity of budget is 0.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param addr_cache the pointer to addr which is user offered, which will save read addr.
+ * @param value_from the pointer to buffer which is user offered that need to save.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_set(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, void *value_from)
+{
+    TFDB_Err_Code result;
+
+    TFDB_RECORD_BEGIN(TFDB_API_SET, index->flash_addr);
+#if TFDB_USE_WRITE_BUDGET
+    if ((index->budget != NULL) && ((index->budget->period == 0) || (index->budget->capacity == 0)))
+    {
+        result = TFDB_PARAM_ERR;
+        goto end;
+    }
+    if ((index->budget != NULL) && (tfdb_budget_take(index->budget) == 0))
+    {
+        if (index->budget->pending != NULL)
+        {
+            tfdb_memcpy(index->budget->pending, value_from, index->value_length);
+            index->budget->pending_valid = 1;
+            index->budget->deferred++;
+            TFDB_TRACE_INFO(TFDB_EVT_BUDGET, 0, index->flash_addr);
+            result = TFDB_NO_ERR;
+        }
+        else
+        {
+            index->budget->rejected++;
+            TFDB_TRACE_INFO(TFDB_EVT_BUDGET, 1, index->flash_addr);
+            result = TFDB_BUDGET_ERR;
+        }
+        goto end;
+    }
+#endif
+    result = tfdb_set_value(index, rw_buffer, addr_cache, value_from);
+#if TFDB_USE_MIRROR
+    /* the mirror is not used by compressed index. */
+    if ((index->mirror != NULL)
+#if TFDB_USE_COMPRESS
+            && (index->compress == 0)
+#endif
+       )
+    {
+        tfdb_mirror_set(index->mirror, result, value_from, index->value_length);
+    }
+#endif
+#if TFDB_USE_WRITE_BUDGET
+    if ((index->budget != NULL) && (result == TFDB_NO_ERR))
+    {
+        /* the pending value is older than this one. */
+        index->budget->pending_valid = 0;
+    }
+end:
+#endif
+    TFDB_RECORD_END(TFDB_API_SET, index->flash_addr, result);
+    return result;
+}
+
+#if TFDB_USE_WRITE_BUDGET
+
+/**
+ * write the deferred value of index to flash when budget is enough.
+ * call it periodically, such as in idle task, or before power down.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param addr_cache the pointer to addr which is user offered, which will save read addr.
+ *
+ * @return TFDB_Err_Code TFDB_NO_ERR when nothing is pending or pending value is written, TFDB_BUDGET_ERR when no write is left.
+ */
+TFDB_Err_Code tfdb_budget_flush(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache)
+{
+    TFDB_Err_Code result = TFDB_NO_ERR;
+    tfdb_budget_t *budget = index->budget;
+
+    TFDB_RECORD_BEGIN(TFDB_API_BUDGET_FLUSH, index->flash_addr);
+    if ((budget == NULL) || (budget->pending_valid == 0))
+    {
+        goto end;
+    }
+    if ((budget->period == 0) || (budget->capacity == 0))
+    {
+        result = TFDB_PARAM_ERR;
+        goto end;
+    }
+    if (tfdb_budget_take(budget) == 0)
+    {
+        result = TFDB_BUDGET_ERR;
+        goto end;
+    }
+    result = tfdb_set_value(index, rw_buffer, addr_cache, budget->pending);
+#if TFDB_USE_MIRROR
+    /* the mirror is not used by compressed index. */
+    if ((index->mirror != NULL)
+#if TFDB_USE_COMPRESS
+            && (index->compress == 0)
+#endif
+       )
+    {
+        tfdb_mirror_set(index->mirror, result, budget->pending, index->value_length);
+    }
+#endif
+    if (result == TFDB_NO_ERR)
+    {
+        budget->pending_valid = 0;
+    }
+end:
+    TFDB_RECORD_END(TFDB_API_BUDGET_FLUSH, index->flash_addr, result);
+    return result;
+}
+
+#endif /* TFDB_USE_WRITE_BUDGET */
+
+/**
+ * get the data in flash and save the addr of data to addr_cache.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param addr_cache the pointer to addr which is user offered.
+ * @param value_to the pointer to buffer which is user offered to save data.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_get_flash(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, void *value_to)
+{
+    TFDB_Err_Code result;
+    tfdb_addr_t find_addr;
+    uint16_t aligned_value_size;
+    uint8_t sum_verify_byte;
+    uint8_t i;
+#if TFDB_USE_ECC
+    uint8_t ecc_state;
+#endif
+
+    aligned_value_size  = tfdb_record_size(index);
+
+    if (addr_cache == NULL)
+    {
+start:
+        /* addr_cache is not init. so check header first. */
+        result = tfdb_check(index, rw_buffer);
+        if (result == TFDB_NO_ERR)
+        {
+            /* the header is right. so start to find data location address in flash. */
+#if TFDB_USE_SLOT_MARKER
+            result = tfdb_marker_find(index, rw_buffer, aligned_value_size, &find_addr);
+            if (result != TFDB_NO_ERR)
+            {
+                goto end;
+            }
+#else
+            find_addr = tfdb_last_slot_addr(index, aligned_value_size);
+#endif
+            while ((find_addr) >= (index->flash_addr + TFDB_DATA_OFFSET(index)))
+            {
+                /* start to find value */
+                result = tfdb_read(index, find_addr, rw_buffer, aligned_value_size);
+                if (result != TFDB_NO_ERR)
+                {
+                    TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, find_addr);
+                    goto end;
+                }
+
+                if (tfdb_end_byte_ok(index, rw_buffer[aligned_value_size - 1]))
+                {
+                    /* find value addr success */
+                    break;
+                }
+
+                if(find_addr >= aligned_value_size)
+                {
+                    find_addr -= aligned_value_size;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+verify:
+            if(!tfdb_end_byte_ok(index, rw_buffer[aligned_value_size - 1]))
+            {
+                TFDB_TRACE_DBG(TFDB_EVT_END_BYTE_ERR, rw_buffer[aligned_value_size - 1], find_addr);
+                goto read_next;
+            }
+#if TFDB_USE_ECC
+            ecc_state = tfdb_ecc_correct(rw_buffer, index->value_length + 1, (rw_buffer[index->value_length + 1] << 8) | rw_buffer[index->value_length + 2]);
+            if (ecc_state == 0xff)
+            {
+                TFDB_TRACE_ERR(TFDB_EVT_ECC_ERR, 0, find_addr);
+                goto read_next;
+            }
+            if (rw_buffer[aligned_value_size - 1] != index->end_byte)
+            {
+                /* one bit error in end_byte. */
+                tfdb_ecc_corrected_count++;
+                ecc_state = 1;
+            }
+            if (ecc_state == 1)
+            {
+                TFDB_TRACE_INFO(TFDB_EVT_ECC_CORRECTED, 0, find_addr);
+            }
+#endif
+
+            sum_verify_byte = 0xff;
+            /* calculate sum verify */
+            for (i = 0; i < index->value_length; i++)
+            {
+                sum_verify_byte = ((sum_verify_byte + rw_buffer[i]) & 0xff);
+            }
+            if (sum_verify_byte != rw_buffer[index->value_length])
+            {
+                /* not right data, maybe the flash is broken. */
+                TFDB_TRACE_ERR(TFDB_EVT_SUM_ERR, (sum_verify_byte << 8) | rw_buffer[index->value_length], find_addr);
+read_next:
+                if (find_addr >= (index->flash_addr + TFDB_DATA_OFFSET(index) + aligned_value_size))
+                {
+                    find_addr = find_addr - aligned_value_size;
+                    result = tfdb_read(index, find_addr, rw_buffer, aligned_value_size);
+                    if (result != TFDB_NO_ERR)
+                    {
+                        TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, find_addr);
+                        goto end;
+                    }
+                    goto verify;
+                }
+                else
+                {
+                    result = TFDB_NO_DATA;
+                    goto end;
+                }
+            }
+            else
+            {
+                result = TFDB_NO_ERR;
+                if(value_to != NULL)
+                {
+                    tfdb_memcpy(value_to, rw_buffer, index->value_length);
+                }
+                if (addr_cache != NULL)
+                {
+                    *addr_cache = find_addr;
+                }
+            }
+        }
+        else
+        {
+            TFDB_TRACE_INFO(TFDB_EVT_HDR_ERR, 0, index->flash_addr);
+            result = TFDB_HDR_ERR;
+            goto end;
+        }
+    }
+    else
+    {
+        if (*addr_cache == 0)
+        {
+            /* addr_cache is not set */
+            goto start;
+        }
+        else
+        {
+            find_addr = *addr_cache;
+            result = tfdb_read(index, find_addr, rw_buffer, aligned_value_size);
+            if (result != TFDB_NO_ERR)
+            {
+                TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, find_addr);
+                goto end;
+            }
+            goto verify;
+        }
+    }
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_GET, result, index->flash_addr);
+    return result;
+}
+
 /**
- * check header in flash.
+ * get the data in flash and save the addr of data to addr_cache.
+ * when index has a valid mirror, the value is copied from RAM without reading flash.
+ * when index has a deferred value in budget, the deferred value is copied and addr_cache is not changed.
  *
  * @param index the data manage index.
  * @param rw_buffer buffer to store prepared read data or write data.
+ * @param addr_cache the pointer to addr which is user offered.
+ * @param value_to the pointer to buffer which is user offered to save data.
  *
  * @return TFDB_Err_Code
  */
-TFDB_Err_Code tfdb_check(const tfdb_index_t *index, uint8_t *rw_buffer)
+TFDB_Err_Code tfdb_get(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, void *value_to)
 {
     TFDB_Err_Code result;
 
-    TFDB_DEBUG("tfdb_check >\n");
-#if (TFDB_WRITE_UNIT_BYTES==8)
-    /* flash_size / value_len / end_byte */
-    result = tfdb_port_read(index->flash_addr, rw_buffer, 8);
-#else
-    /* flash_size / value_len / end_byte */
-    result = tfdb_port_read(index->flash_addr, rw_buffer, 4);
+    TFDB_RECORD_BEGIN(TFDB_API_GET, index->flash_addr);
+#if TFDB_USE_WRITE_BUDGET
+    if ((index->budget != NULL) && (value_to != NULL) && index->budget->pending_valid)
+    {
+        tfdb_memcpy(value_to, index->budget->pending, index->value_length);
+        result = TFDB_NO_ERR;
+    }
+    else
+#endif
+#if TFDB_USE_COMPRESS
+    if (index->compress)
+    {
+        result = tfdb_compress_get(index, rw_buffer, addr_cache, value_to);
+    }
+    else
+#endif
+#if TFDB_USE_MIRROR
+    if ((index->mirror != NULL) && (value_to != NULL) && tfdb_mirror_hit(index->mirror))
+    {
+        tfdb_memcpy(value_to, index->mirror->value, index->value_length);
+        result = TFDB_NO_ERR;
+    }
+    else if (index->mirror != NULL)
+    {
+        result = tfdb_get_flash(index, rw_buffer, addr_cache, value_to);
+        /* the record is still in rw_buffer. */
+        tfdb_mirror_update(index->mirror, result, rw_buffer, index->value_length);
+    }
+    else
+#endif
+    {
+        result = tfdb_get_flash(index, rw_buffer, addr_cache, value_to);
+    }
+    TFDB_RECORD_END(TFDB_API_GET, index->flash_addr, result);
+    return result;
+}
+
+#if TFDB_USE_BAD_SLOT
+
+/**
+ * rebuild the bad slot map of index from flash, call it after power on, tfdb_mount_all calls it for every index.
+ * tfdb_set writes records in order, so the erased slots before the newest record were skipped as bad slots.
+ * the written slots without right record may be broken by power down when writing, they are not marked.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store read data.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_bad_rebuild(const tfdb_index_t *index, uint8_t *rw_buffer)
+{
+    TFDB_Err_Code result = TFDB_NO_ERR;
+    tfdb_addr_t last_addr = 0;
+    tfdb_addr_t find_addr;
+    uint16_t aligned_value_size;
+    uint16_t i;
+    uint8_t pattern[4];
+    uint8_t pattern_size;
+
+    if (index->bad == NULL)
+    {
+        return TFDB_NO_ERR;
+    }
+#if TFDB_USE_COMPRESS
+    if (index->compress)
+    {
+        /* the compressed records are not in slots. */
+        return TFDB_NO_ERR;
+    }
 #endif
+    TFDB_RECORD_BEGIN(TFDB_API_BAD_REBUILD, index->flash_addr);
+    tfdb_bad_clear(index);
+
+    result = tfdb_get_flash(index, rw_buffer, &last_addr, NULL);
     if (result != TFDB_NO_ERR)
     {
-        //read err
-        TFDB_DEBUG("    read err\n");
+        if ((result == TFDB_HDR_ERR) || (result == TFDB_NO_DATA))
+        {
+            /* no record, so no bad slot is known. */
+            result = TFDB_NO_ERR;
+        }
         goto end;
     }
-    result = TFDB_HDR_ERR;
-    /* compare flash_size */
-    if ((rw_buffer[0] == ((index->flash_size >> 8) & 0xff)) && (rw_buffer[1] == ((index->flash_size) & 0xff)))
+    aligned_value_size = tfdb_record_size(index);
+    pattern_size = tfdb_erased_pattern(index, pattern);
+    for (find_addr = index->flash_addr + TFDB_DATA_OFFSET(index); find_addr < last_addr; find_addr += aligned_value_size)
     {
-        /* compare value_length and end_byte */
-        if ((rw_buffer[2] == index->value_length) && (rw_buffer[3] == index->end_byte))
+        result = tfdb_read(index, find_addr, rw_buffer, aligned_value_size);
+        if (result != TFDB_NO_ERR)
+        {
+            TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, find_addr);
+            goto end;
+        }
+        for (i = 0; i < aligned_value_size; i++)
+        {
+            if (rw_buffer[i] != pattern[(find_addr + i) % pattern_size])
+            {
+                break;
+            }
+        }
+        if (i == aligned_value_size)
+        {
+            tfdb_bad_mark(index, aligned_value_size, find_addr);
+        }
+    }
+end:
+    TFDB_RECORD_END(TFDB_API_BAD_REBUILD, index->flash_addr, result);
+    return result;
+}
+
+#endif /* TFDB_USE_BAD_SLOT */
+
+/**
+ * get the previous data in flash and save the addr of data to addr_cache.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param addr_cache the pointer to addr which is user offered.
+ * @param value_to the pointer to buffer which is user offered to save data.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_get_pre(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, tfdb_addr_t *pre_addr_cache, void *value_to)
+{
+    TFDB_Err_Code result;
+    uint16_t aligned_value_size;
+    tfdb_addr_t find_addr;
+
+
+    TFDB_RECORD_BEGIN(TFDB_API_GET_PRE, index->flash_addr);
+#if TFDB_USE_COMPRESS
+    if (index->compress)
+    {
+        result = tfdb_compress_get_pre(index, rw_buffer, addr_cache, pre_addr_cache, value_to);
+        goto end;
+    }
+#endif
+    if(addr_cache == NULL)
+    {
+        goto prepare;
+    }
+    else
+    {
+        if(*addr_cache != 0)
+        {
+            find_addr = *addr_cache;
+find:
+            aligned_value_size  = tfdb_record_size(index);
+
+
+            if (find_addr >= (index->flash_addr + TFDB_DATA_OFFSET(index) + aligned_value_size))
+            {
+                find_addr = find_addr - aligned_value_size;
+                result = tfdb_get_flash(index, rw_buffer, &find_addr, value_to);
+                if(result == TFDB_NO_ERR)
+                {
+                    if(pre_addr_cache != NULL)
+                    {
+                        *pre_addr_cache = find_addr;
+                    }
+                }
+            }
+            else
+            {
+                /* no old data. */
+                result = TFDB_NO_PRE_DATA;
+            }
+        }
+        else
+        {
+prepare:
+            find_addr = 0;
+            result = tfdb_get_flash(index, rw_buffer, &find_addr, value_to);
+            if(result != TFDB_NO_ERR)
+            {
+                goto end;
+            }
+            if(addr_cache != NULL)
+            {
+                *addr_cache = find_addr;
+            }
+            goto find;
+        }
+    }
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_GET_PRE, result, index->flash_addr);
+    TFDB_RECORD_END(TFDB_API_GET_PRE, index->flash_addr, result);
+    return result;
+}
+
+/**
+ * judge which seq is new.
+ *
+ * @param seq the pointer to seq[2] buffer.
+ *
+ * @return uint8_t which seq is new, 0xff means all seq is illegal.
+ */
+static uint8_t tfdb_dual_judge(uint16_t *seq)
+{
+    /* seq range: 0x00ff -> 0x0ff0 -> 0xff00 */
+    switch (seq[0])
+    {
+    case 0xff00:
+        if (seq[1] == 0x00ff)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    case 0x0ff0:
+        if (seq[1] == 0xff00)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    case 0x00ff:
+        if (seq[1] == 0x0ff0)
         {
-            /* check hdr success */
-            result = TFDB_NO_ERR;
-            goto end;
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    default:
+        if ((seq[1] == 0x00ff) || (seq[1] == 0x0ff0) || (seq[1] == 0xff00))
+        {
+            return 1;
         }
+        break;
     }
-end:
-    TFDB_DEBUG("tfdb_check:%d\n", result);
-    return result;
+    return 0xff;
 }
 
 /**
- * erase the flash block and init header in flash.
+ * get next seq from given seq.
  *
- * @param index the data manage index.
- * @param rw_buffer buffer to store prepared read data or write data.
+ * @param seq the pointer to seq[2] buffer.
  *
- * @return TFDB_Err_Code
+ * @return uint8_t which seq is new, 0xff means all seq is illegal.
  */
-TFDB_Err_Code tfdb_init(const tfdb_index_t *index, uint8_t *rw_buffer)
+static uint16_t tfdb_dual_get_next_seq(uint16_t seq)
 {
-    TFDB_Err_Code result = TFDB_NO_ERR;
-
-    TFDB_DEBUG("tfdb_init >\n");
-
-    result = tfdb_port_erase(index->flash_addr, index->flash_size);
-    if (result != TFDB_NO_ERR)
+    /* seq range: 0x00ff -> 0x0ff0 -> 0xff00 */
+    if (seq == 0x00ff)
     {
-        //erase err
-        TFDB_DEBUG("    erase err\n");
-        goto end;
+        return 0x0ff0;
     }
-    rw_buffer[0] = ((index->flash_size >> 8) & 0xff);
-    rw_buffer[1] = ((index->flash_size) & 0xff);
-    rw_buffer[2] = index->value_length;
-    rw_buffer[3] = index->end_byte;
-#if (TFDB_WRITE_UNIT_BYTES==8)
-    rw_buffer[4] = index->end_byte;
-    rw_buffer[5] = index->end_byte;
-    rw_buffer[6] = index->end_byte;
-    rw_buffer[7] = index->end_byte;
-    /* flash_size / value_len / end_byte */
-    result = tfdb_port_write(index->flash_addr, rw_buffer, 8);
-#else
-    /* flash_size / value_len / end_byte */
-    result = tfdb_port_write(index->flash_addr, rw_buffer, 4);
-#endif
-    if (result != TFDB_NO_ERR)
+    else if (seq == 0x0ff0)
     {
-        //write err
-        TFDB_DEBUG("    write err\n");
-        goto end;
+        return 0xff00;
     }
-    result = tfdb_check(index, rw_buffer);
-    if (result != TFDB_NO_ERR)
+    else
     {
-        TFDB_DEBUG("    flash ERR\n");
-        result = TFDB_FLASH_ERR;
-        goto end;
+        return 0x00ff;
     }
-end:
-    TFDB_DEBUG("tfdb_init:%d\n", result);
-    return result;
 }
 
 /**
- * set data in flash and save the addr to addr_cache.
+ * get the data in flash and save the addr and seq to cache.
+ * the seq and value are decoded from rw_buffer directly, so only one buffer is needed.
  *
  * @param index the data manage index.
  * @param rw_buffer buffer to store prepared read data or write data.
- * @param addr_cache the pointer to addr which is user offered, which will save read addr.
- * @param value_from the pointer to buffer which is user offered that need to save.
+ * @param cache the pointer to addr which is user offered, which will save read addr and seq.
+ * @param value_to the pointer to buffer which is user offered to save data, NULL will only update cache.
  *
  * @return TFDB_Err_Code
  */
-TFDB_Err_Code tfdb_set(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, void *value_from)
+TFDB_Err_Code tfdb_dual_get_lite(const tfdb_dual_index_t *index, uint8_t *rw_buffer, tfdb_dual_cache_t *cache, void *value_to)
 {
-    TFDB_Err_Code result;
-    tfdb_addr_t find_addr;
-    uint8_t aligned_value_size;
-    uint8_t sum_verify_byte;
-    uint8_t i;
-#if TFDB_WRITE_MAX_RETRY
-    uint32_t max_retry = 0;
-#endif
-
-    TFDB_DEBUG("tfdb_set >\n");
-
-    aligned_value_size  = index->value_length + 2;/* data + verify + end_byte */
+    TFDB_Err_Code rresult = TFDB_NO_ERR;
+    TFDB_Err_Code result[2];
+    uint8_t judge_state;
 
-#if (TFDB_WRITE_UNIT_BYTES==2)
-    /* aligned with TFDB_WRITE_UNIT_BYTES */
-    aligned_value_size = ((aligned_value_size + 1) & 0xfe);
-#elif (TFDB_WRITE_UNIT_BYTES==4)
-    /* aligned with TFDB_WRITE_UNIT_BYTES */
-    aligned_value_size = ((aligned_value_size + 3) & 0xfc);
-#elif (TFDB_WRITE_UNIT_BYTES==8)
-    /* aligned with TFDB_WRITE_UNIT_BYTES */
-    aligned_value_size = ((aligned_value_size + 7) & 0xf8);
+    TFDB_RECORD_BEGIN(TFDB_API_DUAL_GET, index->indexes[0].flash_addr);
+#if TFDB_USE_COMPRESS
+    if (index->indexes[0].compress || index->indexes[1].compress)
+    {
+        /* the seq prefixed records of dual index can't be compressed. */
+        TFDB_RECORD_END(TFDB_API_DUAL_GET, index->indexes[0].flash_addr, TFDB_PARAM_ERR);
+        return TFDB_PARAM_ERR;
+    }
 #endif
-    TFDB_LOG("aigned size:%d\n", aligned_value_size);
-
-    if (addr_cache == NULL)
+    if (cache != NULL)
     {
-start:
-        /* addr_cache is not init. so check header first. */
-        find_addr = 0;
-        result = tfdb_get(index, rw_buffer, &find_addr, NULL);
-        if(result == TFDB_NO_ERR)
+#if TFDB_USE_MIRROR
+        /* mirror is only valid after a successful get or set, which leaves the cache valid too,
+         * so the seq is not judged until mirror misses or is verified. */
+        if ((index->mirror != NULL) && (value_to != NULL) && tfdb_mirror_hit(index->mirror))
         {
-            find_addr = find_addr + aligned_value_size;
-#if (TFDB_WRITE_UNIT_BYTES==8)
-            if(find_addr > (index->flash_addr + index->flash_size - ((index->flash_size - 8) % aligned_value_size) - aligned_value_size))
-#else
-            if(find_addr > (index->flash_addr + index->flash_size - ((index->flash_size - 4) % aligned_value_size) - aligned_value_size))
+            tfdb_memcpy(value_to, index->mirror->value, index->indexes[0].value_length - 2);
+            TFDB_RECORD_END(TFDB_API_DUAL_GET, index->indexes[0].flash_addr, TFDB_NO_ERR);
+            return TFDB_NO_ERR;
+        }
 #endif
+
+        judge_state = tfdb_dual_judge(cache->seq);
+
+        TFDB_TRACE_DBG(TFDB_EVT_DUAL_JUDGE, judge_state, index->indexes[0].flash_addr);
+
+        /* usually, we just read value once during the initializing. */
+        if (judge_state == 0xff)
+        {
+            /* tfdb_get leaves the verified record in rw_buffer when value_to is NULL. */
+            result[0] = tfdb_get(&index->indexes[0], rw_buffer, &(cache->addr_cache[0]), NULL);
+            if (result[0] == TFDB_NO_ERR)
             {
-                /* the flash block is fill */
-                TFDB_DEBUG("    the flash is fill\n");
-                goto init;
+                cache->seq[0] = (rw_buffer[0] << 8) | (rw_buffer[1]);
+                if (value_to != NULL)
+                {
+                    tfdb_memcpy(value_to, &(rw_buffer[2]), index->indexes[0].value_length - 2);
+                }
             }
-
-            /* find the addr success */
-            TFDB_LOG("    find success\n");
-set:
-            /* calculate sum verify */
-            sum_verify_byte = 0xff;
-            for (i = 0; i < index->value_length; i++)
+            else
             {
-                sum_verify_byte = ((sum_verify_byte + ((uint8_t *)(value_from))[i]) & 0xff);
+                cache->seq[0] = 0;
             }
-write:
-#if TFDB_WRITE_MAX_RETRY
-            max_retry++;
-            if (max_retry > TFDB_WRITE_MAX_RETRY)
+
+            result[1] = tfdb_get(&index->indexes[1], rw_buffer, &(cache->addr_cache[1]), NULL);
+            if (result[1] == TFDB_NO_ERR)
             {
-                result = TFDB_FLASH_ERR;
-                goto end;
+                cache->seq[1] = (rw_buffer[0] << 8) | (rw_buffer[1]);
             }
-#endif
-            tfdb_memcpy(rw_buffer, value_from, index->value_length);
-            rw_buffer[index->value_length] = sum_verify_byte;
-            for (i = index->value_length + 1; i < aligned_value_size; i++)
+            else
             {
-                /* fill aligned data with end_byte */
-                rw_buffer[i] = index->end_byte;
+                cache->seq[1] = 0;
             }
-            result = tfdb_port_write(find_addr, rw_buffer, aligned_value_size);
-            if (result != TFDB_NO_ERR)
+
+            judge_state = tfdb_dual_judge(cache->seq);
+            if (judge_state == 1)
             {
-                TFDB_DEBUG("    write err\n");
-                goto end;
+                if (value_to != NULL)
+                {
+                    tfdb_memcpy(value_to, &(rw_buffer[2]), index->indexes[1].value_length - 2);
+                }
             }
-            result = tfdb_port_read(find_addr, rw_buffer, aligned_value_size);
-            if (result != TFDB_NO_ERR)
+            else if (judge_state == 0xff)
             {
-                TFDB_DEBUG("    read err\n");
-                goto end;
+                rresult = TFDB_SEQ_ERR;
             }
-            if ((tfdb_memcmp(rw_buffer, value_from, index->value_length) != TFDB_MEMCMP_SAME) \
-                    || (rw_buffer[index->value_length] != sum_verify_byte)\
-                    || (rw_buffer[aligned_value_size - 1] != index->end_byte))
+        }
+        else
+        {
+            rresult = tfdb_get(&index->indexes[judge_state], rw_buffer, &(cache->addr_cache[judge_state]), NULL);
+            if (rresult == TFDB_NO_ERR)
             {
-                /* write verify failed, maybe the flash is error, try next address. */
-                TFDB_DEBUG("    Write verify failed, try next address.\n");
-                find_addr += aligned_value_size;
-
-#if (TFDB_WRITE_UNIT_BYTES==8)
-                if(find_addr > (index->flash_addr + index->flash_size - ((index->flash_size - 8) % aligned_value_size) - aligned_value_size))
-#else
-                if(find_addr > (index->flash_addr + index->flash_size - ((index->flash_size - 4) % aligned_value_size) - aligned_value_size))
-#endif
+                if (value_to != NULL)
                 {
-                    /* the flash is fill */
-                    TFDB_DEBUG("    the flash is fill\n");
-                    goto init;
-                }
-                else
-                {
-                    goto write;
+                    tfdb_memcpy(value_to, &(rw_buffer[2]), index->indexes[judge_state].value_length - 2);
                 }
             }
             else
             {
-                /* write data to flash success */
-                /* save addr to addr_cache */
-                if (addr_cache != NULL)
-                {
-                    *addr_cache = find_addr;
-                }
+                /* block not right, don't read another block. */
             }
         }
-        else if (result == TFDB_HDR_ERR)
+    }
+    else
+    {
+        rresult = TFDB_CACHE_ERR;
+    }
+
+#if TFDB_USE_MIRROR
+    if (index->mirror != NULL)
+    {
+        if (value_to != NULL)
         {
-            TFDB_DEBUG("    header err\n");
-init:
-            result = tfdb_init(index, rw_buffer);
-            if (result == TFDB_NO_ERR)
-            {
-after_init:
-#if (TFDB_WRITE_UNIT_BYTES==8)
-                find_addr = index->flash_addr + 8;
-#else
-                find_addr = index->flash_addr + 4;
-#endif
-                goto set;
-            }
-            goto end;
+            tfdb_mirror_update(index->mirror, rresult, value_to, index->indexes[0].value_length - 2);
         }
-        else if (result == TFDB_NO_DATA)
+        else if (rresult != TFDB_NO_ERR)
         {
-            goto after_init;
+            index->mirror->valid = 0;
         }
     }
-    else
+#endif
+
+    TFDB_RECORD_END(TFDB_API_DUAL_GET, index->indexes[0].flash_addr, rresult);
+    return rresult;
+}
+
+/**
+ * set data in flash and save the addr and seq to cache.
+ * the seq prefixed record is built in rw_buffer directly, so only one buffer is needed.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param cache the pointer to addr which is user offered, which will save read addr and seq.
+ * @param value_from the pointer to buffer which is user offered that need to save.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_dual_set_lite(const tfdb_dual_index_t *index, uint8_t *rw_buffer, tfdb_dual_cache_t *cache, void *value_from)
+{
+    TFDB_Err_Code rresult = TFDB_NO_ERR;
+    TFDB_Err_Code result[2];
+    uint8_t judge_state;
+    uint16_t write_seq;
+    uint8_t seq_bytes[2];
+
+    TFDB_RECORD_BEGIN(TFDB_API_DUAL_SET, index->indexes[0].flash_addr);
+#if TFDB_USE_COMPRESS
+    if (index->indexes[0].compress || index->indexes[1].compress)
     {
-        if (*addr_cache == 0)
+        /* the seq prefixed records of dual index can't be compressed. */
+        TFDB_RECORD_END(TFDB_API_DUAL_SET, index->indexes[0].flash_addr, TFDB_PARAM_ERR);
+        return TFDB_PARAM_ERR;
+    }
+#endif
+#if TFDB_USE_WRITE_BUDGET
+    if ((index->indexes[0].budget != NULL) || (index->indexes[1].budget != NULL))
+    {
+        /* the pending value of budget can't keep the seq of dual index. */
+        TFDB_RECORD_END(TFDB_API_DUAL_SET, index->indexes[0].flash_addr, TFDB_PARAM_ERR);
+        return TFDB_PARAM_ERR;
+    }
+#endif
+    if (cache != NULL)
+    {
+        judge_state = tfdb_dual_judge(cache->seq);
+
+        TFDB_TRACE_DBG(TFDB_EVT_DUAL_JUDGE, judge_state, index->indexes[0].flash_addr);
+
+        /* usually, we just read value once during the initializing. */
+        if (judge_state != 0xff)
         {
-            /* addr_cache is not set */
-            goto start;
+write:
+            write_seq = tfdb_dual_get_next_seq(cache->seq[judge_state]);
+            judge_state = 1 - judge_state;  /* we need to write in another flash block. */
+
+            seq_bytes[0] = (uint8_t)(write_seq >> 8);
+            seq_bytes[1] = (uint8_t)write_seq;
+
+            result[judge_state] = tfdb_set_record(&index->indexes[judge_state], rw_buffer, &(cache->addr_cache[judge_state]), seq_bytes, 2, value_from);
+            if (result[judge_state] == TFDB_NO_ERR)
+            {
+                cache->seq[judge_state] = write_seq;
+            }
+            else
+            {
+                /* block is error, do not write to another block, for keeping the old data safe.
+                 * if you want to write in another block, please use tfdb_set directly. */
+                rresult = judge_state + TFDB_FLASH1_ERR;
+            }
         }
         else
         {
-            /* addr_cache is set */
-            TFDB_DEBUG("    addr_cache is set\n");
-            find_addr = *addr_cache + aligned_value_size;
-            if (find_addr > (index->flash_addr + index->flash_size - aligned_value_size))
+            result[0] = tfdb_get(&index->indexes[0], rw_buffer, &(cache->addr_cache[0]), NULL);
+            if (result[0] == TFDB_NO_ERR)
             {
-                /* the flash is fill */
-                TFDB_DEBUG("    the flash is fill\n");
-                goto init;
+                cache->seq[0] = (rw_buffer[0] << 8) | (rw_buffer[1]);
             }
             else
             {
-                goto set;
+                cache->seq[0] = 0;
+            }
+
+            result[1] = tfdb_get(&index->indexes[1], rw_buffer, &(cache->addr_cache[1]), NULL);
+            if (result[1] == TFDB_NO_ERR)
+            {
+                cache->seq[1] = (rw_buffer[0] << 8) | (rw_buffer[1]);
+            }
+            else
+            {
+                cache->seq[1] = 0;
+            }
+
+            judge_state = tfdb_dual_judge(cache->seq);
+            if (judge_state == 0xff)
+            {
+                judge_state = 0;    /* first write 0 block. */
             }
+
+            goto write;
         }
     }
-end:
-    TFDB_LOG("tfdb_set:%d\n", result);
-    return result;
+    else
+    {
+        TFDB_RECORD_END(TFDB_API_DUAL_SET, index->indexes[0].flash_addr, TFDB_CACHE_ERR);
+        return TFDB_CACHE_ERR;
+    }
+
+#if TFDB_USE_MIRROR
+    if (index->mirror != NULL)
+    {
+        tfdb_mirror_set(index->mirror, rresult, value_from, index->indexes[0].value_length - 2);
+    }
+#endif
+
+    TFDB_RECORD_END(TFDB_API_DUAL_SET, index->indexes[0].flash_addr, rresult);
+    return rresult;
 }
 
 /**
- * get the data in flash and save the addr of data to addr_cache.
+ * get the data in flash and save the addr and seq to cache.
+ * @note rw_buffer_bak is not used any more, it is kept for compatibility, please use tfdb_dual_get_lite.
  *
  * @param index the data manage index.
  * @param rw_buffer buffer to store prepared read data or write data.
- * @param addr_cache the pointer to addr which is user offered.
+ * @param rw_buffer_bak not used.
+ * @param cache the pointer to addr which is user offered, which will save read addr and seq.
  * @param value_to the pointer to buffer which is user offered to save data.
  *
  * @return TFDB_Err_Code
  */
-TFDB_Err_Code tfdb_get(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, void *value_to)
+TFDB_Err_Code tfdb_dual_get(const tfdb_dual_index_t *index, uint8_t *rw_buffer, uint8_t *rw_buffer_bak, tfdb_dual_cache_t *cache, void *value_to)
 {
-    TFDB_Err_Code result;
-    tfdb_addr_t find_addr;
-    uint8_t aligned_value_size;
-    uint8_t sum_verify_byte;
-    uint8_t i;
-    TFDB_LOG("tfdb_get >\n");
+    (void)rw_buffer_bak;
+    return tfdb_dual_get_lite(index, rw_buffer, cache, value_to);
+}
 
-    aligned_value_size  = index->value_length + 2;/* data + verify + end_byte */
+/**
+ * set data in flash and save the addr and seq to cache.
+ * @note rw_buffer_bak is not used any more, it is kept for compatibility, please use tfdb_dual_set_lite.
+ *
+ * @param index the data manage index.
+ * @param rw_buffer buffer to store prepared read data or write data.
+ * @param rw_buffer_bak not used.
+ * @param cache the pointer to addr which is user offered, which will save read addr and seq.
+ * @param value_from the pointer to buffer which is user offered that need to save.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_dual_set(const tfdb_dual_index_t *index, uint8_t *rw_buffer, uint8_t *rw_buffer_bak, tfdb_dual_cache_t *cache, void *value_from)
+{
+    (void)rw_buffer_bak;
+    return tfdb_dual_set_lite(index, rw_buffer, cache, value_from);
+}
 
-#if (TFDB_WRITE_UNIT_BYTES==2)
-    /* aligned with TFDB_WRITE_UNIT_BYTES */
-    aligned_value_size = ((aligned_value_size + 1) & 0xfe);
-#elif (TFDB_WRITE_UNIT_BYTES==4)
-    /* aligned with TFDB_WRITE_UNIT_BYTES */
-    aligned_value_size = ((aligned_value_size + 3) & 0xfc);
-#elif (TFDB_WRITE_UNIT_BYTES==8)
-    /* aligned with TFDB_WRITE_UNIT_BYTES */
-    aligned_value_size = ((aligned_value_size + 7) & 0xf8);
-#endif
-    TFDB_LOG("aigned size:%d\n", aligned_value_size);
+/**
+ * check if two name strings are the same.
+ *
+ * @param a the name string.
+ * @param b the name string.
+ *
+ * @return uint8_t 1 means same.
+ */
+static uint8_t tfdb_name_same(const char *a, const char *b)
+{
+    while ((*a != '\0') && (*a == *b))
+    {
+        a++;
+        b++;
+    }
+    return (*a == *b);
+}
 
-    if (addr_cache == NULL)
+/**
+ * get the flash address which is used to sort the mount table.
+ *
+ * @param item the mount table item.
+ *
+ * @return tfdb_addr_t
+ */
+static tfdb_addr_t tfdb_mount_addr(const tfdb_mount_t *item)
+{
+    if (item->index != NULL)
     {
-start:
-        /* addr_cache is not init. so check header first. */
-        result = tfdb_check(index, rw_buffer);
-        if (result == TFDB_NO_ERR)
-        {
-            /* the header is right. so start to find data location address in flash. */
-#if (TFDB_WRITE_UNIT_BYTES==8)
-            find_addr = index->flash_addr + index->flash_size - ((index->flash_size - 8) % aligned_value_size) - aligned_value_size;
-            while ((find_addr) >= (index->flash_addr + 8))
-#else
-            find_addr = index->flash_addr + index->flash_size - ((index->flash_size - 4) % aligned_value_size) - aligned_value_size;
-            while ((find_addr) >= (index->flash_addr + 4))
-#endif
-            {
-                /* start to find value */
-                result = tfdb_port_read(find_addr, rw_buffer, aligned_value_size);
-                if (result != TFDB_NO_ERR)
-                {
-                    TFDB_DEBUG("    read err\n");
-                    goto end;
-                }
+        return item->index->flash_addr;
+    }
+    return item->dual_index->indexes[0].flash_addr;
+}
 
-                if (rw_buffer[aligned_value_size - 1] == index->end_byte)
-                {
-                    /* find value addr success */
-                    break;
-                }
+/**
+ * check headers and find data location of all indexes in mount table, the caches will be refreshed.
+ * the indexes are visited in order of flash address, so the table doesn't need to be sorted.
+ * empty or unformatted flash blocks are not treated as error, their caches stay 0.
+ *
+ * @param table the mount table which is user offered.
+ * @param num the item number of table.
+ * @param rw_buffer buffer to store read data, must be enough for the largest index in table.
+ *
+ * @return TFDB_Err_Code the first error when reading flash, other items are still mounted.
+ */
+TFDB_Err_Code tfdb_mount_all(const tfdb_mount_t *table, uint16_t num, uint8_t *rw_buffer)
+{
+    TFDB_Err_Code rresult = TFDB_NO_ERR;
+    TFDB_Err_Code result;
+    const tfdb_mount_t *item;
+    tfdb_addr_t last_addr = 0;
+    tfdb_addr_t addr;
+    uint16_t last_pos = 0;
+    uint16_t pos;
+    uint16_t mounted;
 
-                if(find_addr >= aligned_value_size)
-                {
-                    find_addr -= aligned_value_size;
-                }
-                else
-                {
-                    break;
-                }
-            }
 
-verify:
-            if(rw_buffer[aligned_value_size - 1] != index->end_byte)
+    TFDB_RECORD_BEGIN(TFDB_API_MOUNT_ALL, 0);
+    for (mounted = 0; mounted < num; mounted++)
+    {
+        /* find the next item by (flash address, table position). */
+        item = NULL;
+        for (pos = 0; pos < num; pos++)
+        {
+            addr = tfdb_mount_addr(&table[pos]);
+            if ((mounted != 0) && ((addr < last_addr) || ((addr == last_addr) && (pos <= last_pos))))
             {
-                TFDB_LOG("end_byte err\n");
-                goto read_next;
+                /* already mounted. */
+                continue;
             }
+            if ((item == NULL) || (addr < tfdb_mount_addr(item)))
+            {
+                item = &table[pos];
+            }
+        }
+        last_addr = tfdb_mount_addr(item);
+        last_pos = (uint16_t)(item - table);
 
-            sum_verify_byte = 0xff;
-            /* calculate sum verify */
-            for (i = 0; i < index->value_length; i++)
+        if (item->index != NULL)
+        {
+            if (item->addr_cache != NULL)
             {
-                sum_verify_byte = ((sum_verify_byte + rw_buffer[i]) & 0xff);
+                *(item->addr_cache) = 0;
             }
-            if (sum_verify_byte != rw_buffer[index->value_length])
+            result = tfdb_get(item->index, rw_buffer, item->addr_cache, NULL);
+        }
+        else
+        {
+            item->dual_cache->addr_cache[0] = 0;
+            item->dual_cache->addr_cache[1] = 0;
+            item->dual_cache->seq[0] = 0;
+            item->dual_cache->seq[1] = 0;
+            result = tfdb_dual_get_lite(item->dual_index, rw_buffer, item->dual_cache, NULL);
+        }
+#if TFDB_USE_BAD_SLOT
+        if (result == TFDB_NO_ERR)
+        {
+            if (item->index != NULL)
             {
-                /* not right data, maybe the flash is broken. */
-                TFDB_LOG("verify err:%02x,%02x\n", sum_verify_byte, rw_buffer[index->value_length]);
-read_next:
-#if (TFDB_WRITE_UNIT_BYTES==8)
-                if (find_addr >= (index->flash_addr + 8 + aligned_value_size))
-#else
-                if (find_addr >= (index->flash_addr + 4 + aligned_value_size))
-#endif
-                {
-                    find_addr = find_addr - aligned_value_size;
-                    result = tfdb_port_read(find_addr, rw_buffer, aligned_value_size);
-                    if (result != TFDB_NO_ERR)
-                    {
-                        TFDB_DEBUG("    read err\n");
-                        goto end;
-                    }
-                    goto verify;
-                }
-                else
-                {
-                    TFDB_DEBUG("    no data in flash\n");
-                    result = TFDB_NO_DATA;
-                    goto end;
-                }
+                result = tfdb_bad_rebuild(item->index, rw_buffer);
             }
             else
             {
-                TFDB_DEBUG("    find success\n");
-                result = TFDB_NO_ERR;
-                if(value_to != NULL)
-                {
-                    tfdb_memcpy(value_to, rw_buffer, index->value_length);
-                }
-                if (addr_cache != NULL)
+                result = tfdb_bad_rebuild(&(item->dual_index->indexes[0]), rw_buffer);
+                if (result == TFDB_NO_ERR)
                 {
-                    *addr_cache = find_addr;
+                    result = tfdb_bad_rebuild(&(item->dual_index->indexes[1]), rw_buffer);
                 }
             }
         }
-        else
+#endif
+        TFDB_TRACE_INFO(TFDB_EVT_MOUNT, result, last_addr);
+
+        if ((result == TFDB_HDR_ERR) || (result == TFDB_NO_DATA) || (result == TFDB_SEQ_ERR))
         {
-            TFDB_DEBUG("    header err\n");
-            result = TFDB_HDR_ERR;
-            goto end;
+            /* not written yet. */
+            result = TFDB_NO_ERR;
         }
-    }
-    else
-    {
-        if (*addr_cache == 0)
+        if ((rresult == TFDB_NO_ERR) && (result != TFDB_NO_ERR))
         {
-            /* addr_cache is not set */
-            goto start;
+            rresult = result;
         }
-        else
+    }
+
+    TFDB_TRACE_INFO(TFDB_EVT_MOUNT_ALL, rresult, num);
+    TFDB_RECORD_END(TFDB_API_MOUNT_ALL, 0, rresult);
+    return rresult;
+}
+
+/**
+ * find the item by name in mount table.
+ *
+ * @param table the mount table which is user offered.
+ * @param num the item number of table.
+ * @param name the name of item.
+ *
+ * @return const tfdb_mount_t* NULL means not found.
+ */
+const tfdb_mount_t *tfdb_mount_find(const tfdb_mount_t *table, uint16_t num, const char *name)
+{
+    uint16_t pos;
+
+    for (pos = 0; pos < num; pos++)
+    {
+        if (tfdb_name_same(table[pos].name, name))
         {
-            find_addr = *addr_cache;
-            result = tfdb_port_read(find_addr, rw_buffer, aligned_value_size);
-            if (result != TFDB_NO_ERR)
-            {
-                TFDB_DEBUG("    read err\n");
-                goto end;
-            }
-            goto verify;
+            return &table[pos];
         }
     }
-end:
-    TFDB_LOG("tfdb_get:%d\n", result);
-    return result;
+    return NULL;
 }
 
+#if TFDB_USE_BLOB
+
+/* flash_size / 0x00 / end_byte / value_length / end_byte, value_length 0 in byte 2 is the tag of blob header. */
+#define TFDB_BLOB_HDR_SIZE                          8
+
+/* value / end_byte filled / sum verify / end_byte, the last write unit is written at last to commit the record.
+ * ECC and slot markers are not used for blob. */
+#define TFDB_BLOB_RECORD_SIZE(index)                (((uint32_t)(index)->value_length + 2 + TFDB_WRITE_UNIT(index) - 1) & ~((uint32_t)TFDB_WRITE_UNIT(index) - 1))
+
 /**
- * get the previous data in flash and save the addr of data to addr_cache.
+ * check the parameters of blob index and buffer.
  *
- * @param index the data manage index.
- * @param rw_buffer buffer to store prepared read data or write data.
- * @param addr_cache the pointer to addr which is user offered.
- * @param value_to the pointer to buffer which is user offered to save data.
+ * @param index the blob manage index.
+ * @param buffer_size the size of buffer.
  *
  * @return TFDB_Err_Code
  */
-TFDB_Err_Code tfdb_get_pre(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, tfdb_addr_t *pre_addr_cache, void *value_to)
+static TFDB_Err_Code tfdb_blob_param_check(const tfdb_blob_index_t *index, uint16_t buffer_size)
 {
-    TFDB_Err_Code result;
-    uint8_t aligned_value_size;
-    tfdb_addr_t find_addr;
+    /* tfdb_blob_set compares the read back and generated bytes in two halves of buffer, every half must be aligned. */
+    if ((buffer_size < TFDB_BLOB_BUFFER_MIN_SIZE) || ((buffer_size % (2 * TFDB_WRITE_UNIT(index))) != 0)
+            || (index->value_length == 0)
+            || (index->flash_size < TFDB_BLOB_HDR_SIZE + TFDB_BLOB_RECORD_SIZE(index)))
+    {
+        return TFDB_PARAM_ERR;
+    }
+    return TFDB_NO_ERR;
+}
 
-    TFDB_LOG("tfdb_get_pre >\n");
+/**
+ * generate bytes of record in order, the value bytes are got from input callback.
+ *
+ * @param index the blob manage index.
+ * @param buffer buffer to save the generated bytes.
+ * @param pos the position in record.
+ * @param size the bytes size to generate.
+ * @param input the callback to get value.
+ * @param user_data the user data of callback.
+ * @param sum the sum verify of value bytes before pos, it's updated after generating.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_blob_fill(const tfdb_blob_index_t *index, uint8_t *buffer, uint16_t pos, uint16_t size, tfdb_blob_input_t input, void *user_data, uint8_t *sum)
+{
+    TFDB_Err_Code result;
+    uint16_t record_size = (uint16_t)TFDB_BLOB_RECORD_SIZE(index);
+    uint16_t value_size = 0;
+    uint16_t i;
 
-    if(addr_cache == NULL)
+    if (pos < index->value_length)
     {
-        goto prepare;
+        value_size = ((index->value_length - pos) > size) ? size : (index->value_length - pos);
+        result = input(user_data, pos, buffer, value_size);
+        if (result != TFDB_NO_ERR)
+        {
+            return result;
+        }
+        for (i = 0; i < value_size; i++)
+        {
+            *sum = (uint8_t)(*sum + buffer[i]);
+        }
     }
-    else
+    for (i = value_size; i < size; i++)
     {
-        if(*addr_cache != 0)
+        if ((pos + i) == (record_size - 2))
         {
-            find_addr = *addr_cache;
-            TFDB_LOG("find_addr:%x\n", find_addr);
-find:
-            aligned_value_size  = index->value_length + 2;  /* data + verify + end_byte */
-
-#if (TFDB_WRITE_UNIT_BYTES==2)
-            /* aligned with TFDB_WRITE_UNIT_BYTES */
-            aligned_value_size = ((aligned_value_size + 1) & 0xfe);
-#elif (TFDB_WRITE_UNIT_BYTES==4)
-            /* aligned with TFDB_WRITE_UNIT_BYTES */
-            aligned_value_size = ((aligned_value_size + 3) & 0xfc);
-#elif (TFDB_WRITE_UNIT_BYTES==8)
-            /* aligned with TFDB_WRITE_UNIT_BYTES */
-            aligned_value_size = ((aligned_value_size + 7) & 0xf8);
-#endif
-
-            TFDB_LOG("aigned size:%d\n", aligned_value_size);
-
-#if (TFDB_WRITE_UNIT_BYTES==8)
-            if(find_addr >= (index->flash_addr + 8 + aligned_value_size))
-#else
-            if(find_addr >= (index->flash_addr + 4 + aligned_value_size))
-#endif
-            {
-                find_addr = find_addr - aligned_value_size;
-                result = tfdb_get(index, rw_buffer, &find_addr, value_to);
-                if(result == TFDB_NO_ERR)
-                {
-                    if(pre_addr_cache != NULL)
-                    {
-                        *pre_addr_cache = find_addr;
-                    }
-                }
-            }
-            else
-            {
-                /* no old data. */
-                result = TFDB_NO_PRE_DATA;
-            }
+            buffer[i] = *sum;
         }
         else
         {
-prepare:
-            find_addr = 0;
-            result = tfdb_get(index, rw_buffer, &find_addr, value_to);
-            if(result != TFDB_NO_ERR)
-            {
-                goto end;
-            }
-            if(addr_cache != NULL)
-            {
-                *addr_cache = find_addr;
-            }
-            goto find;
+            buffer[i] = index->end_byte;
         }
     }
-end:
-    TFDB_LOG("tfdb_get_pre:%d\n", result);
-    return result;
+    return TFDB_NO_ERR;
 }
 
 /**
- * judge which seq is new.
+ * verify the record in flash by end_byte and sum verify.
  *
- * @param seq the pointer to seq[2] buffer.
+ * @param index the blob manage index.
+ * @param buffer buffer to store read data.
+ * @param buffer_size the size of buffer.
+ * @param addr the address of record.
+ * @param output the callback to save value, NULL will only verify the record.
+ * @param user_data the user data of callback.
  *
- * @return uint8_t which seq is new, 0xff means all seq is illegal.
+ * @return TFDB_Err_Code TFDB_NO_DATA means the record is not right.
  */
-static uint8_t tfdb_dual_judge(uint16_t *seq)
+static TFDB_Err_Code tfdb_blob_read_record(const tfdb_blob_index_t *index, uint8_t *buffer, uint16_t buffer_size, tfdb_addr_t addr, tfdb_blob_output_t output, void *user_data)
 {
-    /* seq range: 0x00ff -> 0x0ff0 -> 0xff00 */
-    switch (seq[0])
+    TFDB_Err_Code result;
+    uint16_t record_size = (uint16_t)TFDB_BLOB_RECORD_SIZE(index);
+    uint16_t pos;
+    uint16_t size;
+    uint16_t i;
+    uint8_t sum = 0xff;
+
+    /* check end_byte first, it's the last byte written. */
+    result = tfdb_read(index, addr + record_size - TFDB_WRITE_UNIT(index), buffer, TFDB_WRITE_UNIT(index));
+    if (result != TFDB_NO_ERR)
     {
-    case 0xff00:
-        if (seq[1] == 0x00ff)
-        {
-            return 1;
-        }
-        else
+        TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, addr);
+        return result;
+    }
+    if (buffer[TFDB_WRITE_UNIT(index) - 1] != index->end_byte)
+    {
+        return TFDB_NO_DATA;
+    }
+    for (pos = 0; pos < record_size; pos += size)
+    {
+        size = ((record_size - pos) > buffer_size) ? buffer_size : (record_size - pos);
+        result = tfdb_read(index, addr + pos, buffer, size);
+        if (result != TFDB_NO_ERR)
         {
-            return 0;
+            TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, addr + pos);
+            return result;
         }
-    case 0x0ff0:
-        if (seq[1] == 0xff00)
+        for (i = 0; i < size; i++)
         {
-            return 1;
+            if ((pos + i) < index->value_length)
+            {
+                sum = (uint8_t)(sum + buffer[i]);
+            }
+            else if ((pos + i) == (record_size - 2))
+            {
+                if (buffer[i] != sum)
+                {
+                    TFDB_TRACE_ERR(TFDB_EVT_SUM_ERR, (sum << 8) | buffer[i], addr);
+                    return TFDB_NO_DATA;
+                }
+            }
         }
-        else
+    }
+    if (output == NULL)
+    {
+        return TFDB_NO_ERR;
+    }
+    /* the record is right, read it again for output. */
+    for (pos = 0; pos < index->value_length; pos += size)
+    {
+        size = ((index->value_length - pos) > buffer_size) ? buffer_size : (index->value_length - pos);
+        result = tfdb_read(index, addr + pos, buffer, (size + TFDB_WRITE_UNIT(index) - 1) & ~(TFDB_WRITE_UNIT(index) - 1));
+        if (result != TFDB_NO_ERR)
         {
-            return 0;
+            TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, addr + pos);
+            return result;
         }
-    case 0x00ff:
-        if (seq[1] == 0x0ff0)
+        result = output(user_data, pos, buffer, size);
+        if (result != TFDB_NO_ERR)
         {
-            return 1;
+            return result;
         }
-        else
+    }
+    return TFDB_NO_ERR;
+}
+
+/**
+ * find the newest right record from the start address to the first record.
+ *
+ * @param index the blob manage index.
+ * @param buffer buffer to store read data.
+ * @param buffer_size the size of buffer.
+ * @param find_addr the address to start finding, the address of found record is saved to it.
+ * @param output the callback to save value, NULL will only find the record.
+ * @param user_data the user data of callback.
+ *
+ * @return TFDB_Err_Code
+ */
+static TFDB_Err_Code tfdb_blob_find(const tfdb_blob_index_t *index, uint8_t *buffer, uint16_t buffer_size, tfdb_addr_t *find_addr, tfdb_blob_output_t output, void *user_data)
+{
+    TFDB_Err_Code result;
+    uint16_t record_size = (uint16_t)TFDB_BLOB_RECORD_SIZE(index);
+
+    while (1)
+    {
+        result = tfdb_blob_read_record(index, buffer, buffer_size, *find_addr, output, user_data);
+        if (result != TFDB_NO_DATA)
         {
-            return 0;
+            return result;
         }
-    default:
-        if ((seq[1] == 0x00ff) || (seq[1] == 0x0ff0) || (seq[1] == 0xff00))
+        if (*find_addr < (index->flash_addr + TFDB_BLOB_HDR_SIZE + record_size))
         {
-            return 1;
+            return TFDB_NO_DATA;
         }
-        break;
+        *find_addr -= record_size;
     }
-    return 0xff;
 }
 
 /**
- * get next seq from given seq.
+ * check blob header in flash.
  *
- * @param seq the pointer to seq[2] buffer.
+ * @param index the blob manage index.
+ * @param buffer buffer to store read data.
  *
- * @return uint8_t which seq is new, 0xff means all seq is illegal.
+ * @return TFDB_Err_Code
  */
-static uint16_t tfdb_dual_get_next_seq(uint16_t seq)
+static TFDB_Err_Code tfdb_blob_check(const tfdb_blob_index_t *index, uint8_t *buffer)
 {
-    /* seq range: 0x00ff -> 0x0ff0 -> 0xff00 */
-    if (seq == 0x00ff)
-    {
-        return 0x0ff0;
-    }
-    else if (seq == 0x0ff0)
+    TFDB_Err_Code result;
+
+    result = tfdb_read(index, index->flash_addr, buffer, TFDB_BLOB_HDR_SIZE);
+    if (result != TFDB_NO_ERR)
     {
-        return 0xff00;
+        TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, index->flash_addr);
+        return result;
     }
-    else
+    if ((buffer[0] == ((index->flash_size >> 8) & 0xff)) && (buffer[1] == (index->flash_size & 0xff))
+            && (buffer[2] == 0) && (buffer[3] == index->end_byte)
+            && (buffer[4] == ((index->value_length >> 8) & 0xff)) && (buffer[5] == (index->value_length & 0xff)))
     {
-        return 0x00ff;
+        return TFDB_NO_ERR;
     }
+    return TFDB_HDR_ERR;
 }
 
 /**
- * get the data in flash and save the addr and seq to cache.
+ * erase the flash block and init blob header in flash.
  *
- * @param index the data manage index.
- * @param rw_buffer buffer to store prepared read data or write data.
- * @param rw_buffer_bak buffer to store prepared read data or write data.
- * @param cache the pointer to addr which is user offered, which will save read addr and seq.
- * @param value_from the pointer to buffer which is user offered that need to save.
+ * @param index the blob manage index.
+ * @param buffer buffer to store prepared read data or write data.
  *
  * @return TFDB_Err_Code
  */
-TFDB_Err_Code tfdb_dual_get(const tfdb_dual_index_t *index, uint8_t *rw_buffer, uint8_t *rw_buffer_bak, tfdb_dual_cache_t *cache, void *value_to)
+static TFDB_Err_Code tfdb_blob_init(const tfdb_blob_index_t *index, uint8_t *buffer)
 {
-    TFDB_Err_Code rresult = TFDB_NO_ERR;
-    TFDB_Err_Code result[2];
-    uint8_t judge_state;
+    TFDB_Err_Code result;
 
-    if (cache != NULL)
+    result = tfdb_erase(index, index->flash_addr, index->flash_size);
+    if (result != TFDB_NO_ERR)
     {
-        judge_state = tfdb_dual_judge(cache->seq);
-
-        TFDB_DEBUG("tfdb_dual_judge:%d\n", judge_state);
-
-        /* usually, we just read value once during the initializing. */
-        if (judge_state == 0xff)
-        {
-            result[0] = tfdb_get(&index->indexes[0], rw_buffer, &(cache->addr_cache[0]), rw_buffer_bak);
-            if (result[0] == TFDB_NO_ERR)
-            {
-                cache->seq[0] = (rw_buffer_bak[0] << 8) | (rw_buffer_bak[1]);
-                tfdb_memcpy(value_to, &(rw_buffer_bak[2]), index->indexes[0].value_length - 2);
-            }
-            else
-            {
-                cache->seq[0] = 0;
-            }
+        TFDB_TRACE_ERR(TFDB_EVT_ERASE_ERR, result, index->flash_addr);
+        goto end;
+    }
+    buffer[0] = ((index->flash_size >> 8) & 0xff);
+    buffer[1] = (index->flash_size & 0xff);
+    buffer[2] = 0;
+    buffer[3] = index->end_byte;
+    buffer[4] = ((index->value_length >> 8) & 0xff);
+    buffer[5] = (index->value_length & 0xff);
+    buffer[6] = index->end_byte;
+    buffer[7] = index->end_byte;
+    result = tfdb_write(index, index->flash_addr, buffer, TFDB_BLOB_HDR_SIZE);
+    if (result != TFDB_NO_ERR)
+    {
+        TFDB_TRACE_ERR(TFDB_EVT_WRITE_ERR, result, index->flash_addr);
+        goto end;
+    }
+    result = tfdb_blob_check(index, buffer);
+    if (result != TFDB_NO_ERR)
+    {
+        result = TFDB_FLASH_ERR;
+    }
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_INIT, result, index->flash_addr);
+    return result;
+}
 
-            result[1] = tfdb_get(&index->indexes[1], rw_buffer, &(cache->addr_cache[1]), rw_buffer_bak);
-            if (result[1] == TFDB_NO_ERR)
-            {
-                cache->seq[1] = (rw_buffer_bak[0] << 8) | (rw_buffer_bak[1]);
-            }
-            else
-            {
-                cache->seq[1] = 0;
-            }
+/**
+ * get the blob in flash by chunks, the value is passed to output callback when the whole record is verified.
+ *
+ * @param index the blob manage index.
+ * @param buffer buffer to read flash, it only needs to hold one chunk.
+ * @param buffer_size the size of buffer, must be multiple of (2 * write unit) and not less than TFDB_BLOB_BUFFER_MIN_SIZE.
+ * @param addr_cache the pointer to addr which is user offered.
+ * @param output the callback to save value chunks, NULL will only find the record and update addr_cache.
+ * @param user_data the user data of callback.
+ *
+ * @return TFDB_Err_Code
+ */
+TFDB_Err_Code tfdb_blob_get(const tfdb_blob_index_t *index, uint8_t *buffer, uint16_t buffer_size, tfdb_addr_t *addr_cache, tfdb_blob_output_t output, void *user_data)
+{
+    TFDB_Err_Code result;
+    tfdb_addr_t find_addr;
+    uint16_t record_size;
 
-            judge_state = tfdb_dual_judge(cache->seq);
-            if (judge_state == 1)
-            {
-                tfdb_memcpy(value_to, &(rw_buffer_bak[2]), index->indexes[1].value_length - 2);
-            }
-            else if (judge_state == 0xff)
-            {
-                rresult = TFDB_SEQ_ERR;
-            }
-        }
-        else
+    TFDB_RECORD_BEGIN(TFDB_API_BLOB_GET, index->flash_addr);
+    result = tfdb_blob_param_check(index, buffer_size);
+    if (result != TFDB_NO_ERR)
+    {
+        goto end;
+    }
+    record_size = (uint16_t)TFDB_BLOB_RECORD_SIZE(index);
+    if ((addr_cache != NULL) && (*addr_cache != 0))
+    {
+        find_addr = *addr_cache;
+    }
+    else
+    {
+        result = tfdb_blob_check(index, buffer);
+        if (result != TFDB_NO_ERR)
         {
-            rresult = tfdb_get(&index->indexes[judge_state], rw_buffer, &(cache->addr_cache[judge_state]), rw_buffer_bak);
-            if (rresult == TFDB_NO_ERR)
-            {
-                tfdb_memcpy(value_to, &(rw_buffer_bak[2]), index->indexes[judge_state].value_length - 2);
-            }
-            else
-            {
-                /* block not right, don't read another block. */
-            }
+            goto end;
         }
+        find_addr = index->flash_addr + TFDB_BLOB_HDR_SIZE + ((index->flash_size - TFDB_BLOB_HDR_SIZE) / record_size - 1) * record_size;
     }
-    else
+    result = tfdb_blob_find(index, buffer, buffer_size, &find_addr, output, user_data);
+    if ((result == TFDB_NO_ERR) && (addr_cache != NULL))
     {
-        rresult = TFDB_CACHE_ERR;
+        *addr_cache = find_addr;
     }
-
-    return rresult;
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_BLOB_GET, result, index->flash_addr);
+    TFDB_RECORD_END(TFDB_API_BLOB_GET, index->flash_addr, result);
+    return result;
 }
 
 /**
- * set data in flash and save the addr and seq to cache.
+ * set the blob in flash by chunks, the value is got from input callback, the record is committed by the last write unit.
+ * input may be called more than once for the same offset when verifying, it must give the same data.
+ * when the flash block is full, it's erased before input is called, the old blob is lost if input fails.
  *
- * @param index the data manage index.
- * @param rw_buffer buffer to store prepared read data or write data.
- * @param rw_buffer_bak buffer to store prepared read data or write data.
- * @param cache the pointer to addr which is user offered, which will save read addr and seq.
- * @param value_from the pointer to buffer which is user offered that need to save.
+ * @param index the blob manage index.
+ * @param buffer buffer to write flash, it only needs to hold one chunk.
+ * @param buffer_size the size of buffer, must be multiple of (2 * write unit) and not less than TFDB_BLOB_BUFFER_MIN_SIZE.
+ * @param addr_cache the pointer to addr which is user offered, which will save read addr.
+ * @param input the callback to get value chunks.
+ * @param user_data the user data of callback.
  *
  * @return TFDB_Err_Code
  */
-TFDB_Err_Code tfdb_dual_set(const tfdb_dual_index_t *index, uint8_t *rw_buffer, uint8_t *rw_buffer_bak, tfdb_dual_cache_t *cache, void *value_from)
+TFDB_Err_Code tfdb_blob_set(const tfdb_blob_index_t *index, uint8_t *buffer, uint16_t buffer_size, tfdb_addr_t *addr_cache, tfdb_blob_input_t input, void *user_data)
 {
-    TFDB_Err_Code rresult = TFDB_NO_ERR;
-    TFDB_Err_Code result[2];
-    uint8_t judge_state;
-    uint16_t write_seq;
+    TFDB_Err_Code result;
+    tfdb_addr_t find_addr;
+    uint16_t record_size;
+    uint16_t commit_pos;
+    uint16_t half_size;
+    uint16_t pos;
+    uint16_t size;
+    uint8_t sum;
+    uint8_t verify_sum;
+#if TFDB_WRITE_MAX_RETRY
+    uint32_t max_retry = 0;
+#endif
 
-    if (cache != NULL)
+    TFDB_RECORD_BEGIN(TFDB_API_BLOB_SET, index->flash_addr);
+    result = tfdb_blob_param_check(index, buffer_size);
+    if (result != TFDB_NO_ERR)
     {
-        judge_state = tfdb_dual_judge(cache->seq);
-
-        TFDB_DEBUG("tfdb_dual_judge:%d\n", judge_state);
+        goto end;
+    }
+    record_size = (uint16_t)TFDB_BLOB_RECORD_SIZE(index);
+    commit_pos = record_size - TFDB_WRITE_UNIT(index);
+    half_size = buffer_size / 2;
 
-        /* usually, we just read value once during the initializing. */
-        if (judge_state != 0xff)
+    if ((addr_cache != NULL) && (*addr_cache != 0))
+    {
+        find_addr = *addr_cache + record_size;
+    }
+    else
+    {
+        result = tfdb_blob_check(index, buffer);
+        if (result == TFDB_HDR_ERR)
         {
-write:
-            write_seq = tfdb_dual_get_next_seq(cache->seq[judge_state]);
-            judge_state = 1 - judge_state;  /* we need to write in another flash block. */
-
-            rw_buffer_bak[0] = (uint8_t)(write_seq >> 8);
-            rw_buffer_bak[1] = (uint8_t)write_seq;
-
-            tfdb_memcpy(&(rw_buffer_bak[2]), value_from, index->indexes[judge_state].value_length - 2);
-
-            result[judge_state] = tfdb_set(&index->indexes[judge_state], rw_buffer, &(cache->addr_cache[judge_state]), rw_buffer_bak);
-            if (result[judge_state] == TFDB_NO_ERR)
-            {
-                cache->seq[judge_state] = write_seq;
-            }
-            else
-            {
-                /* block is error, do not write to another block, for keeping the old data safe.
-                 * if you want to write in another block, please use tfdb_set directly. */
-                rresult = judge_state + TFDB_FLASH1_ERR;
-            }
+            goto init;
+        }
+        else if (result != TFDB_NO_ERR)
+        {
+            goto end;
+        }
+        find_addr = index->flash_addr + TFDB_BLOB_HDR_SIZE + ((index->flash_size - TFDB_BLOB_HDR_SIZE) / record_size - 1) * record_size;
+        result = tfdb_blob_find(index, buffer, buffer_size, &find_addr, NULL, NULL);
+        if (result == TFDB_NO_ERR)
+        {
+            find_addr += record_size;
+        }
+        else if (result == TFDB_NO_DATA)
+        {
+            find_addr = index->flash_addr + TFDB_BLOB_HDR_SIZE;
         }
         else
         {
-            result[0] = tfdb_get(&index->indexes[0], rw_buffer, &(cache->addr_cache[0]), rw_buffer_bak);
-            if (result[0] == TFDB_NO_ERR)
-            {
-                cache->seq[0] = (rw_buffer_bak[0] << 8) | (rw_buffer_bak[1]);
-            }
-            else
-            {
-                cache->seq[0] = 0;
-            }
+            goto end;
+        }
+    }
 
-            result[1] = tfdb_get(&index->indexes[1], rw_buffer, &(cache->addr_cache[1]), rw_buffer_bak);
-            if (result[1] == TFDB_NO_ERR)
-            {
-                cache->seq[1] = (rw_buffer_bak[0] << 8) | (rw_buffer_bak[1]);
-            }
-            else
-            {
-                cache->seq[1] = 0;
-            }
+write:
+    if ((find_addr + record_size) > (index->flash_addr + index->flash_size))
+    {
+        /* the flash block is fill */
+        TFDB_TRACE_INFO(TFDB_EVT_FULL, 0, index->flash_addr);
+init:
+        result = tfdb_blob_init(index, buffer);
+        if (result != TFDB_NO_ERR)
+        {
+            goto end;
+        }
+        find_addr = index->flash_addr + TFDB_BLOB_HDR_SIZE;
+    }
+#if TFDB_WRITE_MAX_RETRY
+    max_retry++;
+    if (max_retry > TFDB_WRITE_MAX_RETRY)
+    {
+        result = TFDB_FLASH_ERR;
+        goto end;
+    }
+#endif
 
-            judge_state = tfdb_dual_judge(cache->seq);
-            if (judge_state == 0xff)
-            {
-                judge_state = 0;    /* first write 0 block. */
-            }
+    /* write all chunks except the last write unit. */
+    sum = 0xff;
+    for (pos = 0; pos < commit_pos; pos += size)
+    {
+        size = ((commit_pos - pos) > buffer_size) ? buffer_size : (commit_pos - pos);
+        result = tfdb_blob_fill(index, buffer, pos, size, input, user_data, &sum);
+        if (result != TFDB_NO_ERR)
+        {
+            goto end;
+        }
+        result = tfdb_write(index, find_addr + pos, buffer, size);
+        if (result != TFDB_NO_ERR)
+        {
+            TFDB_TRACE_ERR(TFDB_EVT_WRITE_ERR, result, find_addr + pos);
+            goto end;
+        }
+    }
 
-            goto write;
+    /* verify chunks with half of buffer, the other half is for the expected data. */
+    verify_sum = 0xff;
+    for (pos = 0; pos < commit_pos; pos += size)
+    {
+        size = ((commit_pos - pos) > half_size) ? half_size : (commit_pos - pos);
+        result = tfdb_blob_fill(index, &buffer[half_size], pos, size, input, user_data, &verify_sum);
+        if (result != TFDB_NO_ERR)
+        {
+            goto end;
+        }
+        result = tfdb_read(index, find_addr + pos, buffer, size);
+        if (result != TFDB_NO_ERR)
+        {
+            TFDB_TRACE_ERR(TFDB_EVT_READ_ERR, result, find_addr + pos);
+            goto end;
+        }
+        if (tfdb_memcmp(buffer, &buffer[half_size], size) != TFDB_MEMCMP_SAME)
+        {
+            goto verify_err;
         }
     }
-    else
+
+    /* commit the record. */
+    result = tfdb_blob_fill(index, buffer, commit_pos, TFDB_WRITE_UNIT(index), input, user_data, &sum);
+    if (result != TFDB_NO_ERR)
     {
-        return TFDB_CACHE_ERR;
+        goto end;
+    }
+    result = tfdb_write(index, find_addr + commit_pos, buffer, TFDB_WRITE_UNIT(index));
+    if (result != TFDB_NO_ERR)
+    {
+        TFDB_TRACE_ERR(TFDB_EVT_WRITE_ERR, result, find_addr + commit_pos);
+        goto end;
+    }
+    result = tfdb_blob_read_record(index, buffer, buffer_size, find_addr, NULL, NULL);
+    if (result == TFDB_NO_ERR)
+    {
+        if (addr_cache != NULL)
+        {
+            *addr_cache = find_addr;
+        }
+        goto end;
+    }
+    else if (result != TFDB_NO_DATA)
+    {
+        goto end;
     }
 
-    return rresult;
+verify_err:
+    /* write verify failed, maybe the flash is error, try next address. */
+    TFDB_TRACE_ERR(TFDB_EVT_WRITE_VERIFY_ERR, 0, find_addr);
+    find_addr += record_size;
+    goto write;
+
+end:
+    TFDB_TRACE_INFO(TFDB_EVT_BLOB_SET, result, index->flash_addr);
+    TFDB_RECORD_END(TFDB_API_BLOB_SET, index->flash_addr, result);
+    return result;
 }
+
+#endif /* TFDB_USE_BLOB */
@@ -12,6 +12,22 @@
  * 2022-08-02     smartmx      add TFDB_VALUE_AFTER_ERASE_SIZE option
  * 2023-02-22     smartmx      add dual flash index function
  * 2023-11-07     smartmx      add TFDB_LOG macro.
+ * 2026-10-19     smartmx      add single buffer dual api.
+ * 2026-10-19     smartmx      add mount table.
+ * 2026-10-19     smartmx      add flash device for each index.
+ * 2026-10-19     smartmx      add TFDB_USE_ECC option.
+ * 2026-10-19     smartmx      replace TFDB_LOG with binary trace events.
+ * 2026-10-19     smartmx      add RAM mirror of value.
+ * 2026-10-19     smartmx      add TFDB_USE_OP_RECORD option.
+ * 2026-10-19     smartmx      add TFDB_USE_SLOT_MARKER option.
+ * 2026-10-19     smartmx      add TFDB_USE_BLANK_CHECK option.
+ * 2026-10-19     smartmx      add streaming blob api.
+ * 2026-10-19     smartmx      add write budget of index.
+ * 2026-10-19     smartmx      add bad slot map of index.
+ * 2026-10-19     smartmx      add RLE compressed record of index.
+ * 2026-10-19     smartmx      widen hits of mirror to uint32_t.
+ * 2026-10-19     smartmx      buffer of blob must be multiple of two write units.
+ * 2026-10-19     smartmx      reject write budget with period or capacity of 0.
  *
  */
 #ifndef _TINY_FLASH_DB_H_
@@ -23,20 +39,227 @@
 
 #define TFDB_MAX(A, B)  (((A) > (B)) ? (A) : (B))
 
+#if TFDB_USE_SLOT_MARKER && ((TFDB_SLOT_MARKER_NUM == 0) || (TFDB_SLOT_MARKER_NUM > 254))
+    #error "TFDB_SLOT_MARKER_NUM must be 1 - 254."
+#endif
+
+#if TFDB_USE_ECC
+    #define TFDB_ECC_SIZE   2   /* hamming SECDED code of value and sum verify */
+#else
+    #define TFDB_ECC_SIZE   0
+#endif
+
+/* the tags are xor to end_byte in header, so the block written with other record layout gets TFDB_HDR_ERR. */
+#define TFDB_HDR_TAG_COMPRESS                                               0x80
+#define TFDB_HDR_TAG_ECC                                                    0x40
+#define TFDB_HDR_TAG_MARKER                                                 0x20
+
+#if TFDB_USE_ECC
+    #define TFDB_HDR_TAG_ECC_LAYOUT                                         TFDB_HDR_TAG_ECC
+#else
+    #define TFDB_HDR_TAG_ECC_LAYOUT                                         0x00
+#endif
+
+#if TFDB_USE_SLOT_MARKER
+    #define TFDB_HDR_TAG_MARKER_LAYOUT                                      TFDB_HDR_TAG_MARKER
+#else
+    #define TFDB_HDR_TAG_MARKER_LAYOUT                                      0x00
+#endif
+
+#define TFDB_HDR_LAYOUT_TAG                                                 (TFDB_HDR_TAG_ECC_LAYOUT | TFDB_HDR_TAG_MARKER_LAYOUT)
+
 #if TFDB_WRITE_UNIT_BYTES <= 4
 
-#define TFDB_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)             (TFDB_MAX(VALUE_LENGTH + 1 + ALIGNED_SIZE, 4) / (ALIGNED_SIZE))
-#define TFDB_DUAL_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)        (TFDB_MAX(VALUE_LENGTH + 3 + ALIGNED_SIZE, 4) / (ALIGNED_SIZE))
+#define TFDB_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)             (TFDB_MAX(VALUE_LENGTH + 1 + TFDB_ECC_SIZE + ALIGNED_SIZE, 4) / (ALIGNED_SIZE))
+#define TFDB_DUAL_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)        (TFDB_MAX(VALUE_LENGTH + 3 + TFDB_ECC_SIZE + ALIGNED_SIZE, 4) / (ALIGNED_SIZE))
+#define TFDB_COMPRESS_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)    (TFDB_MAX(VALUE_LENGTH + 2 + TFDB_ECC_SIZE + ALIGNED_SIZE, 4) / (ALIGNED_SIZE))
 
 #else
 
-#define TFDB_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)             (TFDB_MAX(VALUE_LENGTH + 1 + ALIGNED_SIZE, 8) / (ALIGNED_SIZE))
-#define TFDB_DUAL_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)        (TFDB_MAX(VALUE_LENGTH + 3 + ALIGNED_SIZE, 8) / (ALIGNED_SIZE))
+#define TFDB_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)             (TFDB_MAX(VALUE_LENGTH + 1 + TFDB_ECC_SIZE + ALIGNED_SIZE, 8) / (ALIGNED_SIZE))
+#define TFDB_DUAL_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)        (TFDB_MAX(VALUE_LENGTH + 3 + TFDB_ECC_SIZE + ALIGNED_SIZE, 8) / (ALIGNED_SIZE))
+#define TFDB_COMPRESS_ALIGNED_RW_BUFFER_SIZE(VALUE_LENGTH, ALIGNED_SIZE)    (TFDB_MAX(VALUE_LENGTH + 2 + TFDB_ECC_SIZE + ALIGNED_SIZE, 8) / (ALIGNED_SIZE))
 
 #endif /* TFDB_WRITE_UNIT_BYTES < 8 */
 
 #define TFDB_DUAL_VALUE_LENGTH(VALUE_LENGTH)                                (VALUE_LENGTH + 2)
 
+/* trace event id, arg0 and arg1 of every event are noted behind. */
+typedef enum
+{
+    TFDB_EVT_READ_ERR = 0,      /* result, address */
+    TFDB_EVT_WRITE_ERR,         /* result, address */
+    TFDB_EVT_ERASE_ERR,         /* result, flash_addr */
+    TFDB_EVT_WRITE_VERIFY_ERR,  /* 0, address */
+    TFDB_EVT_SUM_ERR,           /* calculated sum << 8 | sum in flash, address */
+    TFDB_EVT_ECC_ERR,           /* 0, address */
+    TFDB_EVT_ECC_CORRECTED,     /* 0, address */
+    TFDB_EVT_END_BYTE_ERR,      /* end_byte in flash, address */
+    TFDB_EVT_CHECK,             /* result, flash_addr */
+    TFDB_EVT_INIT,              /* result, flash_addr */
+    TFDB_EVT_HDR_ERR,           /* 0, flash_addr */
+    TFDB_EVT_FULL,              /* 0, flash_addr */
+    TFDB_EVT_SET,               /* result, flash_addr */
+    TFDB_EVT_GET,               /* result, flash_addr */
+    TFDB_EVT_GET_PRE,           /* result, flash_addr */
+    TFDB_EVT_DUAL_JUDGE,        /* judge state, flash_addr of indexes[0] */
+    TFDB_EVT_MOUNT,             /* result, flash_addr */
+    TFDB_EVT_MOUNT_ALL,         /* result, item number */
+    TFDB_EVT_MARKER,            /* the last written slot marker, flash_addr */
+    TFDB_EVT_BLANK,             /* 1 means blank, flash_addr for skipped erasing or address of skipped slot */
+    TFDB_EVT_BLOB_SET,          /* result, flash_addr */
+    TFDB_EVT_BLOB_GET,          /* result, flash_addr */
+    TFDB_EVT_BUDGET,            /* 0 means value is deferred, 1 means rejected, flash_addr */
+    TFDB_EVT_BAD_SLOT,          /* 0 means bad slot is skipped, 1 means slot is marked bad, address of slot */
+    TFDB_EVT_COMPRESS,          /* length of encoded value, address of record */
+    TFDB_EVT_MAX,
+} tfdb_trace_id_t;
+
+#define TFDB_TRACE_LEVEL_ERR                                                1
+#define TFDB_TRACE_LEVEL_INFO                                               2
+#define TFDB_TRACE_LEVEL_DBG                                                3
+
+#if TFDB_TRACE_LEVEL
+
+#if (TFDB_TRACE_BUFFER_SIZE & (TFDB_TRACE_BUFFER_SIZE - 1)) || (TFDB_TRACE_BUFFER_SIZE > 0x8000)
+    #error "TFDB_TRACE_BUFFER_SIZE must be power of 2 and not bigger than 0x8000."
+#endif
+
+typedef struct _tfdb_trace_event_struct
+{
+    uint16_t        id;             /* tfdb_trace_id_t */
+    uint16_t        arg0;
+    uint32_t        arg1;
+} tfdb_trace_event_t;
+
+extern void tfdb_trace_write(uint16_t id, uint16_t arg0, uint32_t arg1);
+
+extern uint8_t tfdb_trace_read(tfdb_trace_event_t *event);
+
+extern uint32_t tfdb_trace_get_lost(void);
+
+extern const char *tfdb_trace_name(uint16_t id);
+
+#endif /* TFDB_TRACE_LEVEL */
+
+#if TFDB_TRACE_LEVEL >= TFDB_TRACE_LEVEL_ERR
+    #define TFDB_TRACE_ERR(ID, ARG0, ARG1)                                  tfdb_trace_write((ID), (uint16_t)(ARG0), (uint32_t)(ARG1))
+#else
+    #define TFDB_TRACE_ERR(ID, ARG0, ARG1)
+#endif
+
+#if TFDB_TRACE_LEVEL >= TFDB_TRACE_LEVEL_INFO
+    #define TFDB_TRACE_INFO(ID, ARG0, ARG1)                                 tfdb_trace_write((ID), (uint16_t)(ARG0), (uint32_t)(ARG1))
+#else
+    #define TFDB_TRACE_INFO(ID, ARG0, ARG1)
+#endif
+
+#if TFDB_TRACE_LEVEL >= TFDB_TRACE_LEVEL_DBG
+    #define TFDB_TRACE_DBG(ID, ARG0, ARG1)                                  tfdb_trace_write((ID), (uint16_t)(ARG0), (uint32_t)(ARG1))
+#else
+    #define TFDB_TRACE_DBG(ID, ARG0, ARG1)
+#endif
+
+#if TFDB_USE_OP_RECORD
+
+/* record: tick(4) | address(4) | size(2) | op(1) | result(1), all are little endian.
+ * for TFDB_OP_BEGIN and TFDB_OP_END, address is flash_addr of index(0 for mount table) and size is api id. */
+#define TFDB_OP_RECORD_SIZE                                                 12
+
+typedef enum
+{
+    TFDB_OP_READ = 0,
+    TFDB_OP_ERASE,
+    TFDB_OP_WRITE,
+    TFDB_OP_BEGIN,              /* api is called */
+    TFDB_OP_END,                /* api returns, result is the return value */
+} tfdb_op_t;
+
+typedef enum
+{
+    TFDB_API_GET = 0,
+    TFDB_API_GET_PRE,
+    TFDB_API_SET,
+    TFDB_API_DUAL_GET,
+    TFDB_API_DUAL_SET,
+    TFDB_API_MOUNT_ALL,
+    TFDB_API_BLOB_GET,
+    TFDB_API_BLOB_SET,
+    TFDB_API_BUDGET_FLUSH,
+    TFDB_API_BAD_REBUILD,
+    TFDB_API_MAX,
+} tfdb_api_id_t;
+
+/* save the record to RAM, file or uart, it's called in the same context of tfdb api. */
+extern void tfdb_port_record(const uint8_t *record, uint8_t size);
+
+#endif /* TFDB_USE_OP_RECORD */
+
+#if TFDB_USE_OP_RECORD || TFDB_USE_WRITE_BUDGET
+
+/* the tick when operation is finished, the unit is decided by port, such as 1us or 1ms. */
+extern uint32_t tfdb_port_get_tick(void);
+
+#endif
+
+#if TFDB_USE_DEVICE
+
+#define TFDB_DEV_CAP_NONE                                                   0x00
+#define TFDB_DEV_CAP_BLANK_CHECK                                            0x01    /* blank_check is supported */
+
+typedef struct _tfdb_dev_struct tfdb_dev_t;
+
+struct _tfdb_dev_struct
+{
+    TFDB_Err_Code (*read)(const tfdb_dev_t *dev, tfdb_addr_t addr, uint8_t *buf, size_t size);
+    TFDB_Err_Code (*erase)(const tfdb_dev_t *dev, tfdb_addr_t addr, size_t size);
+    TFDB_Err_Code (*write)(const tfdb_dev_t *dev, tfdb_addr_t addr, const uint8_t *buf, size_t size);
+    void           *user_data;                  /* private data of the device driver */
+    uint32_t        value_after_erase;          /* the data value in flash after erased */
+    uint8_t         value_after_erase_size;     /* the size of value_after_erase, only support 1/2/4 */
+    uint8_t         write_unit;                 /* the flash write granularity, only support 1/2/4/8 */
+    uint8_t         caps;                       /* TFDB_DEV_CAP_xxx */
+    /* hardware blank check, *blank is set to 1 when the flash is erased, only used with TFDB_DEV_CAP_BLANK_CHECK. */
+    TFDB_Err_Code (*blank_check)(const tfdb_dev_t *dev, tfdb_addr_t addr, size_t size, uint8_t *blank);
+};
+
+#endif /* TFDB_USE_DEVICE */
+
+#if TFDB_USE_MIRROR
+typedef struct _tfdb_mirror_struct
+{
+    uint8_t         *value;         /* RAM buffer of value, the size must be value_length(value_length - 2 for dual index) */
+    uint8_t         valid;          /* 1 when value is same to flash */
+    uint32_t        hits;           /* the times of reading mirror since last verify */
+    uint16_t        mismatch;       /* the times of mirror different to flash when verifying */
+} tfdb_mirror_t;
+#endif /* TFDB_USE_MIRROR */
+
+#if TFDB_USE_WRITE_BUDGET
+typedef struct _tfdb_budget_struct
+{
+    uint16_t        capacity;       /* the max writes in a burst, must not be 0 */
+    uint16_t        period;         /* the ticks to refill one write, must not be 0 */
+    uint8_t         *pending;       /* RAM buffer of deferred value, the size must be value_length, NULL will reject the write */
+    /* the members below are used by tfdb, init them with 0. */
+    uint8_t         started;        /* 1 when tokens and last_tick are set */
+    uint8_t         pending_valid;  /* 1 when pending value is newer than flash */
+    uint16_t        tokens;         /* the writes can be done now */
+    uint32_t        last_tick;      /* the tick of last refilling */
+    uint32_t        deferred;       /* the times of value deferred */
+    uint32_t        rejected;       /* the times of write rejected */
+} tfdb_budget_t;
+#endif /* TFDB_USE_WRITE_BUDGET */
+
+#if TFDB_USE_BAD_SLOT
+typedef struct _tfdb_bad_struct
+{
+    uint8_t         *map;           /* RAM bitmap of bad slots, bit n(map[n / 8] & (1 << (n % 8))) is the n-th slot */
+    uint16_t        map_size;       /* the size of map, the slots out of map are never marked */
+    uint16_t        count;          /* the count of bad slots in map, for health monitoring */
+} tfdb_bad_t;
+#endif /* TFDB_USE_BAD_SLOT */
+
 typedef struct _tfdb_index_struct
 {
     tfdb_addr_t     flash_addr;     /* the start address of the flash block */
@@ -44,6 +267,21 @@ typedef struct _tfdb_index_struct
     uint8_t         value_length;   /* the length of value that saved in this flash block */
     uint8_t         end_byte;       /* must different to TFDB_VALUE_AFTER_ERASE */
     /* 0x00 is recommended for end_byte, because almost all flash is 0xff after erase. */
+#if TFDB_USE_DEVICE
+    const tfdb_dev_t *dev;          /* the flash device which this flash block is on */
+#endif
+#if TFDB_USE_MIRROR
+    tfdb_mirror_t   *mirror;        /* the RAM mirror of value, NULL to disable. */
+#endif
+#if TFDB_USE_WRITE_BUDGET
+    tfdb_budget_t   *budget;        /* the write budget of index, NULL to disable, must be NULL for dual index. */
+#endif
+#if TFDB_USE_BAD_SLOT
+    tfdb_bad_t      *bad;           /* the bad slot map of index, NULL to disable. */
+#endif
+#if TFDB_USE_COMPRESS
+    uint8_t         compress;       /* 1 to save value with RLE compression, value_length must be less than 255, not for dual index. */
+#endif
 } tfdb_index_t;
 
 extern TFDB_Err_Code tfdb_get(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, void *value_to);
@@ -52,9 +290,32 @@ extern TFDB_Err_Code tfdb_get_pre(const tfdb_index_t *index, uint8_t *rw_buffer,
 
 extern TFDB_Err_Code tfdb_set(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache, void *value_from);
 
+#if TFDB_USE_WRITE_BUDGET
+
+extern TFDB_Err_Code tfdb_budget_flush(const tfdb_index_t *index, uint8_t *rw_buffer, tfdb_addr_t *addr_cache);
+
+#endif
+
+#if TFDB_USE_BAD_SLOT
+
+extern TFDB_Err_Code tfdb_bad_rebuild(const tfdb_index_t *index, uint8_t *rw_buffer);
+
+#endif
+
+#if TFDB_USE_ECC
+
+extern uint32_t tfdb_ecc_get_corrected(void);
+
+extern void tfdb_ecc_clear_corrected(void);
+
+#endif
+
 typedef struct _tfdb_dual_index_struct
 {
     tfdb_index_t indexes[2];
+#if TFDB_USE_MIRROR
+    tfdb_mirror_t   *mirror;        /* the RAM mirror of value, mirror of indexes should be NULL. */
+#endif
 } tfdb_dual_index_t;
 
 typedef struct _tfdb_dual_cache_struct
@@ -63,8 +324,60 @@ typedef struct _tfdb_dual_cache_struct
     uint16_t        seq[2];
 } tfdb_dual_cache_t;
 
+extern TFDB_Err_Code tfdb_dual_get_lite(const tfdb_dual_index_t *index, uint8_t *rw_buffer, tfdb_dual_cache_t *cache, void *value_to);
+
+extern TFDB_Err_Code tfdb_dual_set_lite(const tfdb_dual_index_t *index, uint8_t *rw_buffer, tfdb_dual_cache_t *cache, void *value_from);
+
+/* rw_buffer_bak is not used any more, keep these two api for compatibility. */
 extern TFDB_Err_Code tfdb_dual_get(const tfdb_dual_index_t *index, uint8_t *rw_buffer, uint8_t *rw_buffer_bak, tfdb_dual_cache_t *cache, void *value_to);
 
 extern TFDB_Err_Code tfdb_dual_set(const tfdb_dual_index_t *index, uint8_t *rw_buffer, uint8_t *rw_buffer_bak, tfdb_dual_cache_t *cache, void *value_from);
 
+typedef struct _tfdb_mount_struct
+{
+    const char              *name;          /* the name for tfdb_mount_find */
+    const tfdb_index_t      *index;         /* the single index, NULL for dual index */
+    tfdb_addr_t             *addr_cache;    /* the addr cache of single index */
+    const tfdb_dual_index_t *dual_index;    /* the dual index, NULL for single index */
+    tfdb_dual_cache_t       *dual_cache;    /* the cache of dual index, must not be NULL */
+} tfdb_mount_t;
+
+#define TFDB_MOUNT_INDEX(NAME, INDEX, ADDR_CACHE)                           { (NAME), (INDEX), (ADDR_CACHE), NULL, NULL }
+#define TFDB_MOUNT_DUAL_INDEX(NAME, DUAL_INDEX, DUAL_CACHE)                 { (NAME), NULL, NULL, (DUAL_INDEX), (DUAL_CACHE) }
+#define TFDB_MOUNT_NUM(TABLE)                                               (sizeof(TABLE) / sizeof(tfdb_mount_t))
+
+extern TFDB_Err_Code tfdb_mount_all(const tfdb_mount_t *table, uint16_t num, uint8_t *rw_buffer);
+
+extern const tfdb_mount_t *tfdb_mount_find(const tfdb_mount_t *table, uint16_t num, const char *name);
+
+#if TFDB_USE_BLOB
+
+/* the min size of buffer for blob api, it's multiple of all write units. */
+#define TFDB_BLOB_BUFFER_MIN_SIZE                                           16
+
+typedef struct _tfdb_blob_index_struct
+{
+    tfdb_addr_t     flash_addr;     /* the start address of the flash block */
+    uint16_t        flash_size;     /* the size of the flash block */
+    uint16_t        value_length;   /* the length of blob that saved in this flash block */
+    uint8_t         end_byte;       /* must different to TFDB_VALUE_AFTER_ERASE */
+#if TFDB_USE_DEVICE
+    const tfdb_dev_t *dev;          /* the flash device which this flash block is on */
+#endif
+} tfdb_blob_index_t;
+
+/* give size bytes of blob from offset to buf. */
+typedef TFDB_Err_Code (*tfdb_blob_input_t)(void *user_data, uint16_t offset, uint8_t *buf, uint16_t size);
+
+/* save size bytes of blob from offset, the chunks are given in order after the record is verified. */
+typedef TFDB_Err_Code (*tfdb_blob_output_t)(void *user_data, uint16_t offset, const uint8_t *buf, uint16_t size);
+
+/* buffer_size of tfdb_blob_get and tfdb_blob_set must be a multiple of (2 * write unit) and not less than TFDB_BLOB_BUFFER_MIN_SIZE,
+ * tfdb_blob_set uses the two halves of buffer to verify the written chunks, otherwise TFDB_PARAM_ERR is returned. */
+extern TFDB_Err_Code tfdb_blob_get(const tfdb_blob_index_t *index, uint8_t *buffer, uint16_t buffer_size, tfdb_addr_t *addr_cache, tfdb_blob_output_t output, void *user_data);
+
+extern TFDB_Err_Code tfdb_blob_set(const tfdb_blob_index_t *index, uint8_t *buffer, uint16_t buffer_size, tfdb_addr_t *addr_cache, tfdb_blob_input_t input, void *user_data);
+
+#endif /* TFDB_USE_BLOB */
+
 #endif
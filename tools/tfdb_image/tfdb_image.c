@@ -0,0 +1,686 @@
+/*
+ * Copyright (c) 2022-2023, smartmx - smartmx@qq.com
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2026-10-19     smartmx      the first version, build and dump tfdb flash images on host.
+ * 2026-10-19     smartmx      support TFDB_USE_SLOT_MARKER.
+ * 2026-10-19     smartmx      erased slots skipped by TFDB_USE_BAD_SLOT and TFDB_USE_BLANK_CHECK are not errors.
+ * 2026-10-19     smartmx      refuse the blocks of compressed index.
+ *
+ */
+/*
+ * build:
+ *   gcc -I. -DTFDB_USE_DEVICE=1 -DTFDB_WRITE_UNIT_BYTES=8 tools/tfdb_image/tfdb_image.c tinyflashdb.c -o tfdb_image
+ * add -DTFDB_USE_ECC=1 or -DTFDB_USE_SLOT_MARKER=1 for the devices which use ecc records or slot markers,
+ * add -DTFDB_USE_BAD_SLOT=1 or -DTFDB_USE_BLANK_CHECK=1 for the devices which skip slots, the erased slots before records are not errors.
+ *
+ * usage:
+ *   tfdb_image build [-u write_unit] [-e value_after_erase] desc.txt image.bin
+ *   tfdb_image dump  [-u write_unit] [-e value_after_erase] desc.txt image.bin
+ *
+ * desc.txt, one item every line, numbers can be decimal or 0x hex, '#' starts a comment:
+ *   image  <base> <size>
+ *   index  <name> <flash_addr> <flash_size> <value_length> <end_byte> <hex value | ->
+ *   dual   <name> <flash_addr0> <flash_addr1> <flash_size> <value_length> <end_byte> <hex value | ->
+ * value_length is the same as tfdb_index_t, so the hex value of dual is (value_length - 2) bytes.
+ * '-' means the index is kept erased in image.
+ * the compressed index of TFDB_USE_COMPRESS is not supported, its block is reported as an error when dumping.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinyflashdb.h"
+
+#if (TFDB_USE_DEVICE == 0)
+    #error "tfdb_image must be built with TFDB_USE_DEVICE=1."
+#endif
+
+#if (TFDB_WRITE_UNIT_BYTES != 8)
+    #error "tfdb_image must be built with TFDB_WRITE_UNIT_BYTES=8, the write unit is set by -u."
+#endif
+
+#define TFDB_IMAGE_MAX_ITEMS                64
+#define TFDB_IMAGE_NAME_SIZE                32
+#define TFDB_IMAGE_LINE_SIZE                1024
+
+typedef struct _tfdb_image_item_struct
+{
+    char                name[TFDB_IMAGE_NAME_SIZE];
+    uint8_t             is_dual;
+    uint8_t             has_value;
+    tfdb_dual_index_t   dual;           /* single index only uses indexes[0] */
+    uint8_t             value[256];
+} tfdb_image_item_t;
+
+typedef struct _tfdb_image_struct
+{
+    tfdb_addr_t         base;
+    uint32_t            size;
+    uint8_t             *data;
+    tfdb_image_item_t   items[TFDB_IMAGE_MAX_ITEMS];
+    uint16_t            item_num;
+} tfdb_image_t;
+
+static tfdb_image_t tfdb_image;
+
+/* big enough for the biggest record of any write unit. */
+static uint8_t tfdb_image_rw_buffer[TFDB_DUAL_ALIGNED_RW_BUFFER_SIZE(255, 8) * 8 + 8];
+
+/**
+ * check the operation range of image.
+ *
+ * @param addr flash address.
+ * @param size operation bytes size.
+ *
+ * @return uint8_t 1 means the range is in image.
+ */
+static uint8_t tfdb_image_range_ok(tfdb_addr_t addr, size_t size)
+{
+    return ((addr >= tfdb_image.base) && ((addr - tfdb_image.base) <= tfdb_image.size) && (size <= (tfdb_image.size - (addr - tfdb_image.base))));
+}
+
+static TFDB_Err_Code tfdb_image_read(const tfdb_dev_t *dev, tfdb_addr_t addr, uint8_t *buf, size_t size)
+{
+    (void)dev;
+    if (tfdb_image_range_ok(addr, size) == 0)
+    {
+        return TFDB_READ_ERR;
+    }
+    memcpy(buf, &tfdb_image.data[addr - tfdb_image.base], size);
+    return TFDB_NO_ERR;
+}
+
+static TFDB_Err_Code tfdb_image_erase(const tfdb_dev_t *dev, tfdb_addr_t addr, size_t size)
+{
+    if (tfdb_image_range_ok(addr, size) == 0)
+    {
+        return TFDB_ERASE_ERR;
+    }
+    memset(&tfdb_image.data[addr - tfdb_image.base], (uint8_t)dev->value_after_erase, size);
+    return TFDB_NO_ERR;
+}
+
+static TFDB_Err_Code tfdb_image_write(const tfdb_dev_t *dev, tfdb_addr_t addr, const uint8_t *buf, size_t size)
+{
+    size_t i;
+
+    if ((tfdb_image_range_ok(addr, size) == 0) || ((addr % dev->write_unit) != 0) || ((size % dev->write_unit) != 0))
+    {
+        return TFDB_WRITE_ERR;
+    }
+    for (i = 0; i < size; i++)
+    {
+        /* programming can only change the bits which are not erased. */
+        if ((uint8_t)dev->value_after_erase == 0xff)
+        {
+            tfdb_image.data[addr - tfdb_image.base + i] &= buf[i];
+        }
+        else
+        {
+            tfdb_image.data[addr - tfdb_image.base + i] |= buf[i];
+        }
+    }
+    return TFDB_NO_ERR;
+}
+
+static tfdb_dev_t tfdb_image_dev =
+{
+    .read                   = tfdb_image_read,
+    .erase                  = tfdb_image_erase,
+    .write                  = tfdb_image_write,
+    .user_data              = NULL,
+    .value_after_erase      = 0xff,
+    .value_after_erase_size = 1,
+    .write_unit             = 4,
+    .caps                   = TFDB_DEV_CAP_NONE,
+};
+
+/**
+ * parse the number in decimal or 0x hex.
+ *
+ * @param str the string of number.
+ * @param value the pointer to save the number.
+ *
+ * @return uint8_t 1 means success.
+ */
+static uint8_t tfdb_image_parse_num(const char *str, uint32_t *value)
+{
+    char *end;
+
+    if (str == NULL)
+    {
+        return 0;
+    }
+    *value = (uint32_t)strtoul(str, &end, 0);
+    return ((end != str) && (*end == '\0'));
+}
+
+/**
+ * parse the hex string of value, 0x prefix is allowed.
+ *
+ * @param str the hex string.
+ * @param value the pointer to save bytes.
+ * @param size the bytes size of value.
+ *
+ * @return uint8_t 1 means success.
+ */
+static uint8_t tfdb_image_parse_hex(const char *str, uint8_t *value, uint16_t size)
+{
+    uint16_t i;
+    char byte_str[3];
+    char *end;
+
+    if ((str[0] == '0') && ((str[1] == 'x') || (str[1] == 'X')))
+    {
+        str += 2;
+    }
+    if (strlen(str) != (size_t)size * 2)
+    {
+        return 0;
+    }
+    byte_str[2] = '\0';
+    for (i = 0; i < size; i++)
+    {
+        byte_str[0] = str[i * 2];
+        byte_str[1] = str[i * 2 + 1];
+        value[i] = (uint8_t)strtoul(byte_str, &end, 16);
+        if (*end != '\0')
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * fill an index from description.
+ *
+ * @param index the index to fill.
+ * @param addr the string of flash_addr.
+ * @param size the string of flash_size.
+ * @param length the string of value_length.
+ * @param end_byte the string of end_byte.
+ *
+ * @return uint8_t 1 means success.
+ */
+static uint8_t tfdb_image_parse_index(tfdb_index_t *index, const char *addr, const char *size, const char *length, const char *end_byte)
+{
+    uint32_t num[4];
+
+    if ((tfdb_image_parse_num(addr, &num[0]) == 0) || (tfdb_image_parse_num(size, &num[1]) == 0)
+            || (tfdb_image_parse_num(length, &num[2]) == 0) || (tfdb_image_parse_num(end_byte, &num[3]) == 0))
+    {
+        return 0;
+    }
+    if ((num[1] > 0xffff) || (num[2] == 0) || (num[2] > 0xff) || (num[3] > 0xff))
+    {
+        return 0;
+    }
+    index->flash_addr = num[0];
+    index->flash_size = (uint16_t)num[1];
+    index->value_length = (uint8_t)num[2];
+    index->end_byte = (uint8_t)num[3];
+    index->dev = &tfdb_image_dev;
+    return 1;
+}
+
+/**
+ * load the description file.
+ *
+ * @param path the path of description file.
+ *
+ * @return uint8_t 1 means success.
+ */
+static uint8_t tfdb_image_load_desc(const char *path)
+{
+    FILE *fp;
+    char line[TFDB_IMAGE_LINE_SIZE];
+    char *argv[9];
+    uint8_t argc;
+    uint32_t line_num = 0;
+    tfdb_image_item_t *item;
+    uint8_t value_size;
+    const char *value_str;
+    uint8_t ok = 0;
+
+    fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        printf("can not open %s\n", path);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_num++;
+        if (strchr(line, '#') != NULL)
+        {
+            *strchr(line, '#') = '\0';
+        }
+        argc = 0;
+        argv[argc] = strtok(line, " \t\r\n");
+        while ((argv[argc] != NULL) && (argc < 8))
+        {
+            argc++;
+            argv[argc] = strtok(NULL, " \t\r\n");
+        }
+        if (argc == 0)
+        {
+            continue;
+        }
+        if ((strcmp(argv[0], "image") == 0) && (argc == 3))
+        {
+            if ((tfdb_image_parse_num(argv[1], &tfdb_image.base) == 0) || (tfdb_image_parse_num(argv[2], &tfdb_image.size) == 0)
+                    || (tfdb_image.size == 0))
+            {
+                goto err;
+            }
+            continue;
+        }
+        if (tfdb_image.item_num >= TFDB_IMAGE_MAX_ITEMS)
+        {
+            printf("%s:%u: too many indexes\n", path, line_num);
+            goto end;
+        }
+        item = &tfdb_image.items[tfdb_image.item_num];
+        memset(item, 0, sizeof(tfdb_image_item_t));
+        if ((strcmp(argv[0], "index") == 0) && (argc == 7))
+        {
+            if (tfdb_image_parse_index(&item->dual.indexes[0], argv[2], argv[3], argv[4], argv[5]) == 0)
+            {
+                goto err;
+            }
+            value_size = item->dual.indexes[0].value_length;
+            value_str = argv[6];
+        }
+        else if ((strcmp(argv[0], "dual") == 0) && (argc == 8))
+        {
+            if ((tfdb_image_parse_index(&item->dual.indexes[0], argv[2], argv[4], argv[5], argv[6]) == 0)
+                    || (tfdb_image_parse_index(&item->dual.indexes[1], argv[3], argv[4], argv[5], argv[6]) == 0)
+                    || (item->dual.indexes[0].value_length <= 2))
+            {
+                goto err;
+            }
+            item->is_dual = 1;
+            value_size = item->dual.indexes[0].value_length - 2;
+            value_str = argv[7];
+        }
+        else
+        {
+            goto err;
+        }
+        if (strcmp(value_str, "-") != 0)
+        {
+            if (tfdb_image_parse_hex(value_str, item->value, value_size) == 0)
+            {
+                printf("%s:%u: value must be %u bytes hex\n", path, line_num, value_size);
+                goto end;
+            }
+            item->has_value = 1;
+        }
+        strncpy(item->name, argv[1], TFDB_IMAGE_NAME_SIZE - 1);
+        tfdb_image.item_num++;
+    }
+    if (tfdb_image.size == 0)
+    {
+        printf("%s: image base and size is not set\n", path);
+        goto end;
+    }
+    ok = 1;
+    goto end;
+err:
+    printf("%s:%u: syntax error\n", path, line_num);
+end:
+    fclose(fp);
+    return ok;
+}
+
+/**
+ * print bytes in hex.
+ *
+ * @param data the bytes to print.
+ * @param size the size of bytes.
+ */
+static void tfdb_image_print_hex(const uint8_t *data, uint16_t size)
+{
+    uint16_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        printf("%02x", data[i]);
+    }
+}
+
+/**
+ * write default values of all indexes to image.
+ *
+ * @return uint8_t 1 means success.
+ */
+static uint8_t tfdb_image_build(void)
+{
+    uint16_t i;
+    tfdb_image_item_t *item;
+    tfdb_addr_t addr_cache;
+    tfdb_dual_cache_t dual_cache;
+    TFDB_Err_Code result;
+
+    for (i = 0; i < tfdb_image.item_num; i++)
+    {
+        item = &tfdb_image.items[i];
+        if (item->has_value == 0)
+        {
+            continue;
+        }
+        if (item->is_dual)
+        {
+            memset(&dual_cache, 0, sizeof(dual_cache));
+            result = tfdb_dual_set_lite(&item->dual, tfdb_image_rw_buffer, &dual_cache, item->value);
+        }
+        else
+        {
+            addr_cache = 0;
+            result = tfdb_set(&item->dual.indexes[0], tfdb_image_rw_buffer, &addr_cache, item->value);
+        }
+        if (result != TFDB_NO_ERR)
+        {
+            printf("%s: set failed %d\n", item->name, result);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * check if all bytes are erased.
+ *
+ * @param data the bytes to check.
+ * @param size the size of bytes.
+ *
+ * @return uint8_t 1 means all bytes are erased.
+ */
+static uint8_t tfdb_image_is_erased(const uint8_t *data, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (data[i] != (uint8_t)tfdb_image_dev.value_after_erase)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * dump and validate one flash block.
+ *
+ * @param index the data manage index.
+ * @param is_dual 1 means the records start with seq.
+ *
+ * @return uint32_t the count of errors.
+ */
+static uint32_t tfdb_image_dump_index(const tfdb_index_t *index, uint8_t is_dual)
+{
+    const uint8_t *block;
+    const uint8_t *record;
+    uint16_t hdr_size;
+    uint16_t data_offset;
+    uint16_t record_size;
+    uint16_t slot_num;
+    uint16_t slot;
+    uint16_t used = 0;
+    uint16_t bad = 0;
+    uint16_t last_valid = 0xffff;
+    uint16_t erased_num = 0;
+#if TFDB_USE_BAD_SLOT || TFDB_USE_BLANK_CHECK
+    uint16_t skipped = 0;
+#endif
+    uint8_t sum;
+    uint16_t i;
+    uint32_t errors = 0;
+    tfdb_addr_t addr_cache = 0;
+    TFDB_Err_Code result;
+
+    hdr_size = (index->dev->write_unit == 8) ? 8 : 4;
+#if TFDB_USE_SLOT_MARKER
+    data_offset = hdr_size + TFDB_SLOT_MARKER_NUM * index->dev->write_unit;
+#else
+    data_offset = hdr_size;
+#endif
+    record_size = (index->value_length + 2 + TFDB_ECC_SIZE + index->dev->write_unit - 1) & ~(index->dev->write_unit - 1);
+    printf("  block 0x%08x size %u value_length %u end_byte 0x%02x\n", index->flash_addr, index->flash_size, index->value_length, index->end_byte);
+    if ((tfdb_image_range_ok(index->flash_addr, index->flash_size) == 0) || (index->flash_size < data_offset + record_size))
+    {
+        printf("    error: block is out of image or too small\n");
+        return 1;
+    }
+    block = &tfdb_image.data[index->flash_addr - tfdb_image.base];
+    if (tfdb_image_is_erased(block, index->flash_size))
+    {
+        printf("    header: erased, block is empty\n");
+        return 0;
+    }
+    printf("    header: ");
+    tfdb_image_print_hex(block, hdr_size);
+    if (block[3] == (index->end_byte ^ TFDB_HDR_TAG_COMPRESS))
+    {
+        /* the compressed records are variable length, they are not in slots. */
+        printf(" error: compressed index is not supported\n");
+        return 1;
+    }
+    if ((block[0] != (index->flash_size >> 8)) || (block[1] != (index->flash_size & 0xff))
+            || (block[2] != index->value_length) || (block[3] != (index->end_byte ^ TFDB_HDR_LAYOUT_TAG)))
+    {
+        printf(" error: header is not same to index\n");
+        return 1;
+    }
+    printf(" ok\n");
+#if TFDB_USE_SLOT_MARKER
+    printf("    markers: ");
+    for (i = 0; i < TFDB_SLOT_MARKER_NUM; i++)
+    {
+        printf("%c", (block[hdr_size + (i + 1) * index->dev->write_unit - 1] == index->end_byte) ? '1' : '0');
+    }
+    printf("\n");
+#endif
+
+    slot_num = (index->flash_size - data_offset) / record_size;
+    for (slot = 0; slot < slot_num; slot++)
+    {
+        record = &block[data_offset + slot * record_size];
+        if (tfdb_image_is_erased(record, record_size))
+        {
+            erased_num++;
+            continue;
+        }
+        used++;
+        printf("    slot %u @0x%08x: ", slot, index->flash_addr + data_offset + slot * record_size);
+        if (erased_num != 0)
+        {
+#if TFDB_USE_BAD_SLOT || TFDB_USE_BLANK_CHECK
+            /* the bad or dirty slots are skipped by tfdb_set and kept erased. */
+            skipped += erased_num;
+#else
+            printf("error: record after erased slot, ");
+            errors++;
+#endif
+            erased_num = 0;
+        }
+        if (is_dual)
+        {
+            printf("seq %02x%02x value ", record[0], record[1]);
+            tfdb_image_print_hex(&record[2], index->value_length - 2);
+        }
+        else
+        {
+            printf("value ");
+            tfdb_image_print_hex(record, index->value_length);
+        }
+        sum = 0xff;
+        for (i = 0; i < index->value_length; i++)
+        {
+            sum = (uint8_t)(sum + record[i]);
+        }
+        if ((sum != record[index->value_length]) || (record[record_size - 1] != index->end_byte))
+        {
+            printf(" bad (sum %s, end_byte %s)\n", (sum == record[index->value_length]) ? "ok" : "error",
+                   (record[record_size - 1] == index->end_byte) ? "ok" : "error");
+            bad++;
+        }
+        else
+        {
+            printf(" ok\n");
+            last_valid = slot;
+        }
+    }
+#if TFDB_USE_BAD_SLOT || TFDB_USE_BLANK_CHECK
+    printf("    fill: %u/%u slots used, %u bad, %u skipped, %u%%\n", used, slot_num, bad, skipped, (uint32_t)(used + skipped) * 100 / slot_num);
+#else
+    printf("    fill: %u/%u slots used, %u bad, %u%%\n", used, slot_num, bad, (uint32_t)used * 100 / slot_num);
+#endif
+
+    /* the newest record must be readable by tinyflashdb. */
+    result = tfdb_get(index, tfdb_image_rw_buffer, &addr_cache, NULL);
+    if (result == TFDB_NO_ERR)
+    {
+        printf("    newest: slot %u\n", (addr_cache - index->flash_addr - data_offset) / record_size);
+        if (((addr_cache - index->flash_addr - data_offset) / record_size) != last_valid)
+        {
+            /* ecc may correct a record which is bad in sum verify. */
+            printf("    warning: newest record is not the last valid slot\n");
+        }
+    }
+    else if ((result == TFDB_NO_DATA) && (used == 0))
+    {
+        printf("    newest: no data\n");
+    }
+    else
+    {
+        printf("    error: tfdb_get failed %d\n", result);
+        errors++;
+    }
+    return errors;
+}
+
+/**
+ * dump and validate all indexes in image.
+ *
+ * @return uint32_t the count of errors.
+ */
+static uint32_t tfdb_image_dump(void)
+{
+    uint16_t i;
+    tfdb_image_item_t *item;
+    tfdb_dual_cache_t dual_cache;
+    TFDB_Err_Code result;
+    uint32_t errors = 0;
+
+    for (i = 0; i < tfdb_image.item_num; i++)
+    {
+        item = &tfdb_image.items[i];
+        printf("%s %s\n", item->is_dual ? "dual" : "index", item->name);
+        errors += tfdb_image_dump_index(&item->dual.indexes[0], item->is_dual);
+        if (item->is_dual)
+        {
+            errors += tfdb_image_dump_index(&item->dual.indexes[1], 1);
+            memset(&dual_cache, 0, sizeof(dual_cache));
+            result = tfdb_dual_get_lite(&item->dual, tfdb_image_rw_buffer, &dual_cache, item->value);
+            if (result == TFDB_NO_ERR)
+            {
+                printf("  current: seq %04x/%04x value ", dual_cache.seq[0], dual_cache.seq[1]);
+                tfdb_image_print_hex(item->value, item->dual.indexes[0].value_length - 2);
+                printf("\n");
+            }
+            else
+            {
+                printf("  current: no valid data %d\n", result);
+            }
+        }
+    }
+    return errors;
+}
+
+static void tfdb_image_usage(void)
+{
+    printf("usage:\n");
+    printf("  tfdb_image build [-u write_unit] [-e value_after_erase] desc.txt image.bin\n");
+    printf("  tfdb_image dump  [-u write_unit] [-e value_after_erase] desc.txt image.bin\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int arg = 2;
+    uint32_t num;
+    FILE *fp;
+    uint32_t errors;
+
+    if ((argc < 4) || ((strcmp(argv[1], "build") != 0) && (strcmp(argv[1], "dump") != 0)))
+    {
+        tfdb_image_usage();
+        return 2;
+    }
+    while ((arg < argc - 2) && (argv[arg][0] == '-'))
+    {
+        if ((arg + 1 >= argc - 2) || (tfdb_image_parse_num(argv[arg + 1], &num) == 0))
+        {
+            tfdb_image_usage();
+            return 2;
+        }
+        if ((strcmp(argv[arg], "-u") == 0) && ((num == 1) || (num == 2) || (num == 4) || (num == 8)))
+        {
+            tfdb_image_dev.write_unit = (uint8_t)num;
+        }
+        else if ((strcmp(argv[arg], "-e") == 0) && ((num == 0x00) || (num == 0xff)))
+        {
+            tfdb_image_dev.value_after_erase = num;
+        }
+        else
+        {
+            tfdb_image_usage();
+            return 2;
+        }
+        arg += 2;
+    }
+    if ((arg != argc - 2) || (tfdb_image_load_desc(argv[arg]) == 0))
+    {
+        tfdb_image_usage();
+        return 2;
+    }
+    tfdb_image.data = malloc(tfdb_image.size);
+    if (tfdb_image.data == NULL)
+    {
+        return 2;
+    }
+    memset(tfdb_image.data, (uint8_t)tfdb_image_dev.value_after_erase, tfdb_image.size);
+
+    if (strcmp(argv[1], "build") == 0)
+    {
+        if (tfdb_image_build() == 0)
+        {
+            return 1;
+        }
+        fp = fopen(argv[arg + 1], "wb");
+        if ((fp == NULL) || (fwrite(tfdb_image.data, 1, tfdb_image.size, fp) != tfdb_image.size))
+        {
+            printf("can not write %s\n", argv[arg + 1]);
+            return 1;
+        }
+        fclose(fp);
+        printf("%u indexes, %u bytes written to %s\n", tfdb_image.item_num, tfdb_image.size, argv[arg + 1]);
+        return 0;
+    }
+
+    fp = fopen(argv[arg + 1], "rb");
+    if ((fp == NULL) || (fread(tfdb_image.data, 1, tfdb_image.size, fp) != tfdb_image.size))
+    {
+        printf("can not read %u bytes from %s\n", tfdb_image.size, argv[arg + 1]);
+        return 1;
+    }
+    fclose(fp);
+    errors = tfdb_image_dump();
+    printf("%u errors\n", errors);
+    return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2022-2023, smartmx - smartmx@qq.com
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2026-10-19     smartmx      the first version, replay records of TFDB_USE_OP_RECORD on host.
+ *
+ */
+/*
+ * build:
+ *   gcc -I. -DTFDB_USE_OP_RECORD=1 tools/tfdb_replay/tfdb_replay.c -o tfdb_replay
+ *
+ * usage:
+ *   tfdb_replay [options] records.bin
+ *   -t tick_us       time of one tick in records, default 1000
+ *   -s sector_size   erase sector size of flash, default 4096
+ *   -c cycles        erase endurance of every sector, default 10000
+ *   -o op_us         fixed time of every flash operation, default 5
+ *   -r read_us       read time of every byte, default 0.05
+ *   -w write_us      write time of every byte, default 12.5
+ *   -e erase_us      erase time of every sector, default 20000
+ *
+ * the records are fed to a simulated flash which only keeps erase counts, the time of every api call is
+ * the sum of its flash operations in timing model, nested api calls are counted in the outermost call.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinyflashdb.h"
+
+#if (TFDB_USE_OP_RECORD == 0)
+    #error "tfdb_replay must be built with TFDB_USE_OP_RECORD=1."
+#endif
+
+typedef struct _tfdb_replay_sector_struct
+{
+    uint32_t        addr;
+    uint32_t        erases;
+} tfdb_replay_sector_t;
+
+typedef struct _tfdb_replay_api_struct
+{
+    double          *model_us;      /* modeled latency of every call */
+    uint32_t        num;
+    uint32_t        capacity;
+    uint32_t        fails;
+    double          measured_max_us;
+} tfdb_replay_api_t;
+
+typedef struct _tfdb_replay_struct
+{
+    double                  tick_us;
+    uint32_t                sector_size;
+    uint32_t                cycles;
+    double                  op_us;
+    double                  read_us;
+    double                  write_us;
+    double                  erase_us;
+
+    tfdb_replay_sector_t    *sectors;
+    uint32_t                sector_num;
+    uint32_t                sector_capacity;
+
+    tfdb_replay_api_t       apis[TFDB_API_MAX];
+    uint32_t                ops[TFDB_OP_END + 1];
+    uint64_t                read_bytes;
+    uint64_t                write_bytes;
+    uint32_t                op_fails;
+    uint32_t                outside_ops;    /* operations not in any api call */
+    uint64_t                ticks;          /* total time of records */
+} tfdb_replay_t;
+
+static const char *tfdb_replay_api_name[TFDB_API_MAX] =
+{
+    "get", "get_pre", "set", "dual_get", "dual_set", "mount_all", "blob_get", "blob_set",
+    "budget_flush", "bad_rebuild",
+};
+
+static tfdb_replay_t tfdb_replay =
+{
+    .tick_us        = 1000,
+    .sector_size    = 4096,
+    .cycles         = 10000,
+    .op_us          = 5,
+    .read_us        = 0.05,
+    .write_us       = 12.5,
+    .erase_us       = 20000,
+};
+
+/**
+ * add erase count to every sector in the erase range.
+ *
+ * @param addr the erase address.
+ * @param size the erase size.
+ *
+ * @return uint32_t the count of erased sectors.
+ */
+static uint32_t tfdb_replay_erase(uint32_t addr, uint32_t size)
+{
+    uint32_t sector_addr;
+    uint32_t end;
+    uint32_t i;
+    uint32_t count = 0;
+
+    if (size == 0)
+    {
+        return 0;
+    }
+    end = addr + size - 1;
+    for (sector_addr = addr - (addr % tfdb_replay.sector_size); sector_addr <= end; sector_addr += tfdb_replay.sector_size)
+    {
+        for (i = 0; i < tfdb_replay.sector_num; i++)
+        {
+            if (tfdb_replay.sectors[i].addr == sector_addr)
+            {
+                break;
+            }
+        }
+        if (i == tfdb_replay.sector_num)
+        {
+            if (tfdb_replay.sector_num == tfdb_replay.sector_capacity)
+            {
+                tfdb_replay.sector_capacity = tfdb_replay.sector_capacity ? tfdb_replay.sector_capacity * 2 : 64;
+                tfdb_replay.sectors = realloc(tfdb_replay.sectors, tfdb_replay.sector_capacity * sizeof(tfdb_replay_sector_t));
+                if (tfdb_replay.sectors == NULL)
+                {
+                    exit(2);
+                }
+            }
+            tfdb_replay.sectors[i].addr = sector_addr;
+            tfdb_replay.sectors[i].erases = 0;
+            tfdb_replay.sector_num++;
+        }
+        tfdb_replay.sectors[i].erases++;
+        count++;
+        if (sector_addr + tfdb_replay.sector_size < sector_addr)
+        {
+            /* address overflow. */
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * save the modeled latency of an outermost api call.
+ *
+ * @param api the api id.
+ * @param model_us the modeled latency.
+ * @param measured_us the latency measured by ticks in records.
+ * @param result the return value of api.
+ */
+static void tfdb_replay_api_done(uint16_t api, double model_us, double measured_us, uint8_t result)
+{
+    tfdb_replay_api_t *item = &tfdb_replay.apis[api];
+
+    if (item->num == item->capacity)
+    {
+        item->capacity = item->capacity ? item->capacity * 2 : 256;
+        item->model_us = realloc(item->model_us, item->capacity * sizeof(double));
+        if (item->model_us == NULL)
+        {
+            exit(2);
+        }
+    }
+    item->model_us[item->num++] = model_us;
+    if (result != TFDB_NO_ERR)
+    {
+        item->fails++;
+    }
+    if (measured_us > item->measured_max_us)
+    {
+        item->measured_max_us = measured_us;
+    }
+}
+
+/**
+ * replay all records in file.
+ *
+ * @param fp the records file.
+ *
+ * @return uint8_t 1 means success.
+ */
+static uint8_t tfdb_replay_file(FILE *fp)
+{
+    uint8_t record[TFDB_OP_RECORD_SIZE];
+    uint32_t tick;
+    uint32_t last_tick = 0;
+    uint32_t begin_tick = 0;
+    uint32_t addr;
+    uint16_t size;
+    uint8_t op;
+    uint8_t result;
+    uint8_t first = 1;
+    uint32_t depth = 0;
+    uint16_t api = 0;
+    double cost;
+    double model_us = 0;
+    uint32_t index = 0;
+
+    while (fread(record, 1, TFDB_OP_RECORD_SIZE, fp) == TFDB_OP_RECORD_SIZE)
+    {
+        tick = record[0] | ((uint32_t)record[1] << 8) | ((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+        addr = record[4] | ((uint32_t)record[5] << 8) | ((uint32_t)record[6] << 16) | ((uint32_t)record[7] << 24);
+        size = record[8] | ((uint16_t)record[9] << 8);
+        op = record[10];
+        result = record[11];
+        if (first == 0)
+        {
+            /* the tick may wrap around. */
+            tfdb_replay.ticks += (uint32_t)(tick - last_tick);
+        }
+        first = 0;
+        last_tick = tick;
+
+        switch (op)
+        {
+        case TFDB_OP_READ:
+        case TFDB_OP_WRITE:
+        case TFDB_OP_ERASE:
+            tfdb_replay.ops[op]++;
+            if (result != TFDB_NO_ERR)
+            {
+                tfdb_replay.op_fails++;
+            }
+            if (op == TFDB_OP_READ)
+            {
+                tfdb_replay.read_bytes += size;
+                cost = tfdb_replay.op_us + tfdb_replay.read_us * size;
+            }
+            else if (op == TFDB_OP_WRITE)
+            {
+                tfdb_replay.write_bytes += size;
+                cost = tfdb_replay.op_us + tfdb_replay.write_us * size;
+            }
+            else
+            {
+                cost = tfdb_replay.op_us + tfdb_replay.erase_us * tfdb_replay_erase(addr, size);
+            }
+            if (depth != 0)
+            {
+                model_us += cost;
+            }
+            else
+            {
+                tfdb_replay.outside_ops++;
+            }
+            break;
+        case TFDB_OP_BEGIN:
+            if (size >= TFDB_API_MAX)
+            {
+                printf("record %u: unknown api %u\n", index, size);
+                return 0;
+            }
+            if (depth == 0)
+            {
+                api = size;
+                model_us = 0;
+                begin_tick = tick;
+            }
+            depth++;
+            break;
+        case TFDB_OP_END:
+            if (depth == 0)
+            {
+                /* recording started inside an api call. */
+                break;
+            }
+            depth--;
+            if (depth == 0)
+            {
+                tfdb_replay_api_done(api, model_us, (double)(uint32_t)(tick - begin_tick) * tfdb_replay.tick_us, result);
+            }
+            break;
+        default:
+            printf("record %u: unknown op %u\n", index, op);
+            return 0;
+        }
+        index++;
+    }
+    if (index == 0)
+    {
+        printf("no records\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int tfdb_replay_compare(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * get the percentile of sorted data by nearest rank.
+ *
+ * @param data the sorted data.
+ * @param num the number of data.
+ * @param percent the percentile.
+ *
+ * @return double
+ */
+static double tfdb_replay_percentile(const double *data, uint32_t num, uint32_t percent)
+{
+    uint32_t rank = (uint32_t)(((uint64_t)num * percent + 99) / 100);
+    return data[(rank == 0) ? 0 : (rank - 1)];
+}
+
+/**
+ * print the report of wear and latency.
+ */
+static void tfdb_replay_report(void)
+{
+    double days;
+    double per_day;
+    double worst_per_day = 0;
+    uint32_t worst = 0;
+    uint32_t i;
+    tfdb_replay_api_t *item;
+
+    days = (double)tfdb_replay.ticks * tfdb_replay.tick_us / 86400e6;
+    printf("records: %.3f days, read %u (%llu bytes), write %u (%llu bytes), erase %u, failed %u, outside api %u\n",
+           days, tfdb_replay.ops[TFDB_OP_READ], (unsigned long long)tfdb_replay.read_bytes,
+           tfdb_replay.ops[TFDB_OP_WRITE], (unsigned long long)tfdb_replay.write_bytes,
+           tfdb_replay.ops[TFDB_OP_ERASE], tfdb_replay.op_fails, tfdb_replay.outside_ops);
+
+    printf("\nsector       erases   erases/day   lifetime(years)\n");
+    for (i = 0; i < tfdb_replay.sector_num; i++)
+    {
+        if (days > 0)
+        {
+            per_day = tfdb_replay.sectors[i].erases / days;
+            printf("0x%08x %8u %12.2f %17.2f\n", tfdb_replay.sectors[i].addr, tfdb_replay.sectors[i].erases,
+                   per_day, tfdb_replay.cycles / per_day / 365);
+        }
+        else
+        {
+            per_day = tfdb_replay.sectors[i].erases;
+            printf("0x%08x %8u %12s %17s\n", tfdb_replay.sectors[i].addr, tfdb_replay.sectors[i].erases, "-", "-");
+        }
+        if (per_day > worst_per_day)
+        {
+            worst_per_day = per_day;
+            worst = i;
+        }
+    }
+    if ((tfdb_replay.sector_num != 0) && (days > 0))
+    {
+        printf("projected lifetime: %.2f years, limited by sector 0x%08x\n",
+               tfdb_replay.cycles / worst_per_day / 365, tfdb_replay.sectors[worst].addr);
+    }
+    else if (tfdb_replay.sector_num == 0)
+    {
+        printf("no erase in records\n");
+    }
+
+    printf("\napi            calls  failed   p50(us)   p90(us)   p99(us)   max(us)  measured max(us)\n");
+    for (i = 0; i < TFDB_API_MAX; i++)
+    {
+        item = &tfdb_replay.apis[i];
+        if (item->num == 0)
+        {
+            continue;
+        }
+        qsort(item->model_us, item->num, sizeof(double), tfdb_replay_compare);
+        printf("%-12s %7u %7u %9.1f %9.1f %9.1f %9.1f %17.1f\n", tfdb_replay_api_name[i], item->num, item->fails,
+               tfdb_replay_percentile(item->model_us, item->num, 50), tfdb_replay_percentile(item->model_us, item->num, 90),
+               tfdb_replay_percentile(item->model_us, item->num, 99), item->model_us[item->num - 1], item->measured_max_us);
+    }
+}
+
+static void tfdb_replay_usage(void)
+{
+    printf("usage: tfdb_replay [-t tick_us] [-s sector_size] [-c cycles] [-o op_us] [-r read_us] [-w write_us] [-e erase_us] records.bin\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int arg = 1;
+    double value;
+    char *end;
+    FILE *fp;
+    uint8_t ok;
+
+    while ((arg < argc - 1) && (argv[arg][0] == '-') && (argv[arg][1] != '\0') && (argv[arg][2] == '\0'))
+    {
+        value = strtod(argv[arg + 1], &end);
+        if ((end == argv[arg + 1]) || (*end != '\0') || (value < 0))
+        {
+            tfdb_replay_usage();
+            return 2;
+        }
+        switch (argv[arg][1])
+        {
+        case 't':
+            tfdb_replay.tick_us = value;
+            break;
+        case 's':
+            tfdb_replay.sector_size = (uint32_t)value;
+            break;
+        case 'c':
+            tfdb_replay.cycles = (uint32_t)value;
+            break;
+        case 'o':
+            tfdb_replay.op_us = value;
+            break;
+        case 'r':
+            tfdb_replay.read_us = value;
+            break;
+        case 'w':
+            tfdb_replay.write_us = value;
+            break;
+        case 'e':
+            tfdb_replay.erase_us = value;
+            break;
+        default:
+            tfdb_replay_usage();
+            return 2;
+        }
+        arg += 2;
+    }
+    if ((arg != argc - 1) || (tfdb_replay.sector_size == 0))
+    {
+        tfdb_replay_usage();
+        return 2;
+    }
+    fp = fopen(argv[arg], "rb");
+    if (fp == NULL)
+    {
+        printf("can not open %s\n", argv[arg]);
+        return 2;
+    }
+    ok = tfdb_replay_file(fp);
+    fclose(fp);
+    if (ok == 0)
+    {
+        return 1;
+    }
+    tfdb_replay_report();
+    return 0;
+}
@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2022-2023, smartmx - smartmx@qq.com
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2026-10-19     smartmx      the first version, check records and ecc on host.
+ * 2026-10-19     smartmx      check bad slot map after erasing.
+ * 2026-10-19     smartmx      check RLE round trip of compressed index.
+ *
+ */
+/*
+ * build:
+ *   gcc -I. -DTFDB_USE_DEVICE=1 -DTFDB_WRITE_UNIT_BYTES=8 -DTFDB_USE_ECC=1 -DTFDB_USE_BAD_SLOT=1 -DTFDB_USE_COMPRESS=1 tools/tfdb_selftest/tfdb_selftest.c tinyflashdb.c -o tfdb_selftest
+ * the checks of options which are not enabled are skipped.
+ *
+ * usage:
+ *   tfdb_selftest
+ * every check runs on a RAM flash with write unit 1/2/4/8 and erased value 0xff/0x00, returns 1 when any check fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinyflashdb.h"
+
+#if (TFDB_USE_DEVICE == 0)
+    #error "tfdb_selftest must be built with TFDB_USE_DEVICE=1."
+#endif
+
+#if (TFDB_WRITE_UNIT_BYTES != 8)
+    #error "tfdb_selftest must be built with TFDB_WRITE_UNIT_BYTES=8, every write unit is checked."
+#endif
+
+#define TFDB_SELFTEST_FLASH_SIZE            0x4000
+
+#define TFDB_SELFTEST_CHECK(COND)                                                           \
+    do                                                                                      \
+    {                                                                                       \
+        tfdb_selftest_checks++;                                                             \
+        if (!(COND))                                                                        \
+        {                                                                                   \
+            printf("  %s:%d unit %u erased 0x%02x: %s\n", __FILE__, __LINE__,               \
+                   tfdb_selftest_dev.write_unit, (uint8_t)tfdb_selftest_dev.value_after_erase, #COND); \
+            tfdb_selftest_fails++;                                                          \
+        }                                                                                   \
+    } while (0)
+
+static uint8_t tfdb_selftest_flash[TFDB_SELFTEST_FLASH_SIZE];
+
+static uint32_t tfdb_selftest_checks;
+
+static uint32_t tfdb_selftest_fails;
+
+static uint32_t tfdb_selftest_erases;
+
+/* the byte at this address is programmed wrong, TFDB_SELFTEST_FLASH_SIZE means no weak byte. */
+static tfdb_addr_t tfdb_selftest_weak_addr = TFDB_SELFTEST_FLASH_SIZE;
+
+/* big enough for the biggest record of any write unit. */
+static uint8_t tfdb_selftest_rw_buffer[TFDB_DUAL_ALIGNED_RW_BUFFER_SIZE(255, 8) * 8 + 8];
+
+static TFDB_Err_Code tfdb_selftest_read(const tfdb_dev_t *dev, tfdb_addr_t addr, uint8_t *buf, size_t size)
+{
+    (void)dev;
+    if ((addr > TFDB_SELFTEST_FLASH_SIZE) || (size > TFDB_SELFTEST_FLASH_SIZE - addr))
+    {
+        return TFDB_READ_ERR;
+    }
+    memcpy(buf, &tfdb_selftest_flash[addr], size);
+    return TFDB_NO_ERR;
+}
+
+static TFDB_Err_Code tfdb_selftest_erase(const tfdb_dev_t *dev, tfdb_addr_t addr, size_t size)
+{
+    if ((addr > TFDB_SELFTEST_FLASH_SIZE) || (size > TFDB_SELFTEST_FLASH_SIZE - addr))
+    {
+        return TFDB_ERASE_ERR;
+    }
+    memset(&tfdb_selftest_flash[addr], (uint8_t)dev->value_after_erase, size);
+    tfdb_selftest_erases++;
+    return TFDB_NO_ERR;
+}
+
+static TFDB_Err_Code tfdb_selftest_write(const tfdb_dev_t *dev, tfdb_addr_t addr, const uint8_t *buf, size_t size)
+{
+    size_t i;
+
+    if ((addr > TFDB_SELFTEST_FLASH_SIZE) || (size > TFDB_SELFTEST_FLASH_SIZE - addr)
+            || ((addr % dev->write_unit) != 0) || ((size % dev->write_unit) != 0))
+    {
+        return TFDB_WRITE_ERR;
+    }
+    for (i = 0; i < size; i++)
+    {
+        /* programming can only change the bits which are not erased. */
+        if ((uint8_t)dev->value_after_erase == 0xff)
+        {
+            tfdb_selftest_flash[addr + i] &= buf[i];
+        }
+        else
+        {
+            tfdb_selftest_flash[addr + i] |= buf[i];
+        }
+        if ((addr + i) == tfdb_selftest_weak_addr)
+        {
+            tfdb_selftest_flash[addr + i] ^= 0x10;
+        }
+    }
+    return TFDB_NO_ERR;
+}
+
+static tfdb_dev_t tfdb_selftest_dev =
+{
+    .read                   = tfdb_selftest_read,
+    .erase                  = tfdb_selftest_erase,
+    .write                  = tfdb_selftest_write,
+    .user_data              = NULL,
+    .value_after_erase      = 0xff,
+    .value_after_erase_size = 1,
+    .write_unit             = 4,
+    .caps                   = TFDB_DEV_CAP_NONE,
+};
+
+/**
+ * erase the RAM flash and init an index on it.
+ *
+ * @param index the index to init.
+ * @param flash_size the size of flash block.
+ * @param value_length the length of value.
+ */
+static void tfdb_selftest_index(tfdb_index_t *index, uint16_t flash_size, uint8_t value_length)
+{
+    memset(tfdb_selftest_flash, (uint8_t)tfdb_selftest_dev.value_after_erase, sizeof(tfdb_selftest_flash));
+    tfdb_selftest_weak_addr = TFDB_SELFTEST_FLASH_SIZE;
+    memset(index, 0, sizeof(tfdb_index_t));
+    index->flash_addr = 0;
+    index->flash_size = flash_size;
+    index->value_length = value_length;
+    /* all bits are different to erased value, so one bit error of end_byte can be corrected. */
+    index->end_byte = (uint8_t)~tfdb_selftest_dev.value_after_erase;
+    index->dev = &tfdb_selftest_dev;
+}
+
+/**
+ * the newest value is got after every set, including the sets which erase the flash block.
+ */
+static void tfdb_selftest_record(void)
+{
+    tfdb_index_t index;
+    uint8_t set_value[7], value[7];
+    tfdb_addr_t addr = 0, find_addr;
+    uint16_t i;
+
+    tfdb_selftest_index(&index, 256, sizeof(value));
+    for (i = 0; i < 100; i++)
+    {
+        memset(set_value, (uint8_t)i, sizeof(set_value));
+        set_value[0] = (uint8_t)(i >> 8);
+        TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, set_value) == TFDB_NO_ERR);
+        find_addr = 0;
+        TFDB_SELFTEST_CHECK(tfdb_get(&index, tfdb_selftest_rw_buffer, &find_addr, value) == TFDB_NO_ERR);
+        TFDB_SELFTEST_CHECK((find_addr == addr) && (memcmp(value, set_value, sizeof(value)) == 0));
+    }
+}
+
+#if TFDB_USE_ECC
+
+/**
+ * every one bit error of value, sum and ecc in the newest record is corrected,
+ * two bits error falls back to the previous record.
+ */
+static void tfdb_selftest_ecc(void)
+{
+    tfdb_index_t index;
+    uint8_t old_value[13], new_value[13], value[13];
+    tfdb_addr_t addr = 0, find_addr;
+    uint16_t bit;
+    uint8_t i;
+
+    tfdb_selftest_index(&index, 1024, sizeof(value));
+    for (i = 0; i < sizeof(value); i++)
+    {
+        old_value[i] = (uint8_t)(i * 17);
+        new_value[i] = (uint8_t)(0xa5 ^ (i * 29));
+    }
+    TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, old_value) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, new_value) == TFDB_NO_ERR);
+
+    /* value + sum + ecc, and end_byte in the last byte of record. */
+    for (bit = 0; bit < (sizeof(value) + 1 + TFDB_ECC_SIZE + 1) * 8; bit++)
+    {
+        tfdb_addr_t flip_addr = (bit < (sizeof(value) + 1 + TFDB_ECC_SIZE) * 8) ? (addr + bit / 8)
+                                : (addr + ((sizeof(value) + 1 + TFDB_ECC_SIZE + index.dev->write_unit) & ~(index.dev->write_unit - 1)) - 1);
+
+        tfdb_selftest_flash[flip_addr] ^= (uint8_t)(1 << (bit % 8));
+        tfdb_ecc_clear_corrected();
+        find_addr = 0;
+        memset(value, 0, sizeof(value));
+        TFDB_SELFTEST_CHECK(tfdb_get(&index, tfdb_selftest_rw_buffer, &find_addr, value) == TFDB_NO_ERR);
+        TFDB_SELFTEST_CHECK((find_addr == addr) && (memcmp(value, new_value, sizeof(value)) == 0));
+        TFDB_SELFTEST_CHECK(tfdb_ecc_get_corrected() == 1);
+        tfdb_selftest_flash[flip_addr] ^= (uint8_t)(1 << (bit % 8));
+    }
+
+    /* two bits error can't be corrected. */
+    tfdb_selftest_flash[addr] ^= 0x01;
+    tfdb_selftest_flash[addr + 5] ^= 0x10;
+    find_addr = 0;
+    TFDB_SELFTEST_CHECK(tfdb_get(&index, tfdb_selftest_rw_buffer, &find_addr, value) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK((find_addr < addr) && (memcmp(value, old_value, sizeof(value)) == 0));
+}
+
+#endif /* TFDB_USE_ECC */
+
+#if TFDB_USE_BAD_SLOT
+
+/**
+ * the slot which fails write verify is marked and skipped, the map is cleared when the flash block is erased,
+ * and a set erases the flash block once when every slot is marked.
+ */
+static void tfdb_selftest_bad_slot(void)
+{
+    static uint8_t map[8];
+    static tfdb_bad_t bad = { map, sizeof(map), 0 };
+    tfdb_index_t index;
+    uint8_t set_value[5] = { 1, 2, 3, 4, 5 }, value[5];
+    tfdb_addr_t addr = 0, find_addr, first_addr, record_size;
+    uint32_t erases;
+
+    tfdb_selftest_index(&index, 256, sizeof(value));
+    index.bad = &bad;
+    TFDB_SELFTEST_CHECK(tfdb_bad_rebuild(&index, tfdb_selftest_rw_buffer) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, set_value) == TFDB_NO_ERR);
+    first_addr = addr;
+    TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, set_value) == TFDB_NO_ERR);
+    record_size = addr - first_addr;
+
+    /* the third slot is weak. */
+    tfdb_selftest_weak_addr = first_addr + 2 * record_size;
+    TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, set_value) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK((addr == first_addr + 3 * record_size) && (bad.count == 1) && (map[0] == 0x04));
+
+    /* the map is cleared by erasing, and the weak slot is marked again after trying. */
+    erases = tfdb_selftest_erases;
+    while (tfdb_selftest_erases == erases)
+    {
+        set_value[0]++;
+        TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, set_value) == TFDB_NO_ERR);
+    }
+    TFDB_SELFTEST_CHECK((tfdb_selftest_erases == erases + 1) && (addr == first_addr) && (bad.count == 0) && (map[0] == 0));
+    set_value[0]++;
+    TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, set_value) == TFDB_NO_ERR);
+    set_value[0]++;
+    TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, set_value) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK((addr == first_addr + 3 * record_size) && (bad.count == 1) && (map[0] == 0x04));
+
+    /* every slot is marked, only one erase, then the value is programmed. */
+    tfdb_selftest_weak_addr = TFDB_SELFTEST_FLASH_SIZE;
+    memset(map, 0xff, sizeof(map));
+    erases = tfdb_selftest_erases;
+    set_value[0]++;
+    TFDB_SELFTEST_CHECK(tfdb_set(&index, tfdb_selftest_rw_buffer, &addr, set_value) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK((tfdb_selftest_erases == erases + 1) && (addr == first_addr) && (bad.count == 0));
+    find_addr = 0;
+    TFDB_SELFTEST_CHECK(tfdb_get(&index, tfdb_selftest_rw_buffer, &find_addr, value) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK((find_addr == addr) && (memcmp(value, set_value, sizeof(value)) == 0));
+}
+
+#endif /* TFDB_USE_BAD_SLOT */
+
+#if TFDB_USE_COMPRESS
+
+#define TFDB_SELFTEST_COMPRESS_LENGTH       254
+
+/**
+ * set the value to compressed index and get it back by cold scan and by addr_cache.
+ *
+ * @param index the compressed index.
+ * @param addr_cache the addr_cache of index.
+ * @param set_value the value to set.
+ * @param encoded_len the expected length of encoded data, 0 will not check it.
+ */
+static void tfdb_selftest_compress_value(const tfdb_index_t *index, tfdb_addr_t *addr_cache, const uint8_t *set_value, uint8_t encoded_len)
+{
+    uint8_t value[TFDB_SELFTEST_COMPRESS_LENGTH];
+    tfdb_addr_t find_addr = 0;
+
+    TFDB_SELFTEST_CHECK(tfdb_set(index, tfdb_selftest_rw_buffer, addr_cache, (void *)set_value) == TFDB_NO_ERR);
+    if (encoded_len != 0)
+    {
+        /* the length of encoded data is the first byte of record. */
+        TFDB_SELFTEST_CHECK(tfdb_selftest_flash[*addr_cache] == encoded_len);
+    }
+    memset(value, 0x5a, sizeof(value));
+    TFDB_SELFTEST_CHECK(tfdb_get(index, tfdb_selftest_rw_buffer, &find_addr, value) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK((find_addr == *addr_cache) && (memcmp(value, set_value, sizeof(value)) == 0));
+    memset(value, 0x5a, sizeof(value));
+    TFDB_SELFTEST_CHECK(tfdb_get(index, tfdb_selftest_rw_buffer, addr_cache, value) == TFDB_NO_ERR);
+    TFDB_SELFTEST_CHECK(memcmp(value, set_value, sizeof(value)) == 0);
+}
+
+/**
+ * RLE round trip of incompressible value, runs at the end of value and the runs around the max length 130,
+ * the literals around the max length 128.
+ */
+static void tfdb_selftest_compress(void)
+{
+    tfdb_index_t index;
+    uint8_t set_value[TFDB_SELFTEST_COMPRESS_LENGTH];
+    tfdb_addr_t addr = 0;
+    uint16_t run, i;
+
+    tfdb_selftest_index(&index, 2048, sizeof(set_value));
+    index.compress = 1;
+
+    /* no run, so the value is copied. */
+    for (i = 0; i < sizeof(set_value); i++)
+    {
+        set_value[i] = (uint8_t)(i * 7 + 1);
+    }
+    tfdb_selftest_compress_value(&index, &addr, set_value, sizeof(set_value));
+
+    /* one run of 130 and one run of 124. */
+    memset(set_value, 0, sizeof(set_value));
+    tfdb_selftest_compress_value(&index, &addr, set_value, 4);
+
+    /* the runs of 3 and 2 at the end. */
+    for (i = 0; i < sizeof(set_value); i++)
+    {
+        set_value[i] = (uint8_t)(i * 7 + 1);
+    }
+    for (run = 2; run <= 3; run++)
+    {
+        memset(&set_value[sizeof(set_value) - run], 0xa5, run);
+        tfdb_selftest_compress_value(&index, &addr, set_value, 0);
+    }
+
+    /* the runs around the max length at the end and at the start, the literals before them. */
+    for (run = 126; run <= 134; run++)
+    {
+        for (i = 0; i < sizeof(set_value); i++)
+        {
+            set_value[i] = (uint8_t)(i * 7 + 1);
+        }
+        memset(&set_value[sizeof(set_value) - run], 0xa5, run);
+        tfdb_selftest_compress_value(&index, &addr, set_value, 0);
+        for (i = 0; i < sizeof(set_value); i++)
+        {
+            set_value[i] = (uint8_t)(i * 7 + 1);
+        }
+        memset(set_value, (uint8_t)run, run);
+        tfdb_selftest_compress_value(&index, &addr, set_value, 0);
+    }
+}
+
+#endif /* TFDB_USE_COMPRESS */
+
+/**
+ * run a check with every write unit and erased value.
+ *
+ * @param name the name of check.
+ * @param check the check function.
+ */
+static void tfdb_selftest_run(const char *name, void (*check)(void))
+{
+    static const uint8_t units[] = { 1, 2, 4, 8 };
+    uint32_t fails = tfdb_selftest_fails;
+    uint8_t i, erased;
+
+    for (i = 0; i < sizeof(units); i++)
+    {
+        for (erased = 0; erased < 2; erased++)
+        {
+            tfdb_selftest_dev.write_unit = units[i];
+            tfdb_selftest_dev.value_after_erase = erased ? 0x00 : 0xff;
+            check();
+        }
+    }
+    printf("%s: %s\n", name, (fails == tfdb_selftest_fails) ? "ok" : "failed");
+}
+
+int main(void)
+{
+    tfdb_selftest_run("record", tfdb_selftest_record);
+#if TFDB_USE_ECC
+    tfdb_selftest_run("ecc", tfdb_selftest_ecc);
+#else
+    printf("ecc: skipped, build with -DTFDB_USE_ECC=1\n");
+#endif
+#if TFDB_USE_BAD_SLOT
+    tfdb_selftest_run("bad slot", tfdb_selftest_bad_slot);
+#else
+    printf("bad slot: skipped, build with -DTFDB_USE_BAD_SLOT=1\n");
+#endif
+#if TFDB_USE_COMPRESS
+    tfdb_selftest_run("compress", tfdb_selftest_compress);
+#else
+    printf("compress: skipped, build with -DTFDB_USE_COMPRESS=1\n");
+#endif
+    printf("%u checks, %u failed\n", tfdb_selftest_checks, tfdb_selftest_fails);
+    return (tfdb_selftest_fails == 0) ? 0 : 1;
+}